@@ -2,6 +2,8 @@
 #include "datamanager.h"
 #include "reportstrategy.h"
 #include "categorydelegate.h"
+#include "orderexporter.h"
+#include "perfstats.h"
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QFileDialog>
@@ -18,6 +20,13 @@
 #include <QDate>
 #include <QMouseEvent>
 #include <QApplication>
+#include <QDebug>
+#include <QProgressDialog>
+#include <QSaveFile>
+#include <QThread>
+#include <QPointer>
+#include <atomic>
+#include <memory>
 
 AdminWindow::AdminWindow(User *user, QWidget *parent)
     : QMainWindow(parent)
@@ -28,15 +37,19 @@ AdminWindow::AdminWindow(User *user, QWidget *parent)
 {
     setWindowTitle("Панель администратора - " + user->getUsername());
     setupUI();
-    loadCategories();
-    loadMeals();
-    loadOrders();
+    ensureTabLoaded(m_tabWidget->currentIndex());
+    
+    // Плановая архивация: при открытии и затем раз в час, если включена
+    m_archiveTimer = new QTimer(this);
+    m_archiveTimer->setInterval(60 * 60 * 1000);
+    connect(m_archiveTimer, &QTimer::timeout, this, &AdminWindow::onScheduledArchive);
+    m_archiveTimer->start();
+    QTimer::singleShot(0, this, &AdminWindow::onScheduledArchive);
 }
 
 AdminWindow::~AdminWindow()
 {
     delete m_reportManager;
-    delete m_sortStrategy;
 }
 
 void AdminWindow::closeEvent(QCloseEvent *event)
@@ -50,27 +63,63 @@ void AdminWindow::setupUI()
     m_tabWidget = new QTabWidget(this);
     setCentralWidget(m_tabWidget);
     
-    setupMenuTab();
-    setupOrdersTab();
-    setupReportsTab();
+    // Вкладки заполняются и загружают данные при первом показе (ensureTabLoaded)
+    m_menuTab = new QWidget();
+    m_ordersTab = new QWidget();
+    m_reportsTab = new QWidget();
+    m_diagnosticsTab = new QWidget();
+    m_tabWidget->addTab(m_menuTab, "Управление меню");
+    m_tabWidget->addTab(m_ordersTab, "Заказы");
+    m_tabWidget->addTab(m_reportsTab, "Отчеты");
+    m_tabWidget->addTab(m_diagnosticsTab, "Диагностика");
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, &AdminWindow::ensureTabLoaded);
     
     qApp->installEventFilter(this);
     
     resize(1000, 700);
 }
 
+void AdminWindow::ensureTabLoaded(int index)
+{
+    QWidget *tab = m_tabWidget->widget(index);
+    if (!tab) {
+        return;
+    }
+    if (m_loadedTabs.contains(tab)) {
+        // Замеры обновляются при каждом открытии вкладки
+        if (tab == m_diagnosticsTab) {
+            onRefreshDiagnostics();
+        }
+        return;
+    }
+    m_loadedTabs.insert(tab);
+    
+    if (tab == m_menuTab) {
+        setupMenuTab();
+        loadCategories();
+        loadMeals();
+    } else if (tab == m_ordersTab) {
+        setupOrdersTab();
+        loadOrders();
+    } else if (tab == m_reportsTab) {
+        setupReportsTab();
+    } else if (tab == m_diagnosticsTab) {
+        setupDiagnosticsTab();
+        onRefreshDiagnostics();
+    }
+}
+
 void AdminWindow::setupMenuTab()
 {
-    m_menuTab = new QWidget();
     QVBoxLayout *mainLayout = new QVBoxLayout(m_menuTab);
     
     // Сортировка
     QHBoxLayout *sortLayout = new QHBoxLayout();
     sortLayout->addWidget(new QLabel("Сортировка:"));
     m_sortCombo = new QComboBox();
-    m_sortCombo->addItem("По названию", 0);
-    m_sortCombo->addItem("По цене (возрастание)", 1);
-    m_sortCombo->addItem("По цене (убывание)", 2);
+    for (const SortStrategyRegistry::Entry &entry : SortStrategyRegistry::getInstance().entries()) {
+        m_sortCombo->addItem(entry.title, entry.id);
+    }
     connect(m_sortCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &AdminWindow::onSortMealsChanged);
     sortLayout->addWidget(m_sortCombo);
     sortLayout->addStretch();
@@ -162,13 +211,11 @@ void AdminWindow::setupMenuTab()
             }
         }
     });
-    
-    m_tabWidget->addTab(m_menuTab, "Управление меню");
+
 }
 
 void AdminWindow::setupOrdersTab()
 {
-    m_ordersTab = new QWidget();
     QVBoxLayout *mainLayout = new QVBoxLayout(m_ordersTab);
     
     // Фильтры
@@ -188,9 +235,27 @@ void AdminWindow::setupOrdersTab()
     filterLayout->addWidget(m_clearFilterButton);
     m_exportOrdersButton = new QPushButton("Экспорт в JSON");
     filterLayout->addWidget(m_exportOrdersButton);
+    m_importStudentsButton = new QPushButton("Импорт учеников");
+    filterLayout->addWidget(m_importStudentsButton);
     filterLayout->addStretch();
     mainLayout->addLayout(filterLayout);
     
+    // Архивация старых заказов
+    const ArchivePolicy policy = DataManager::getInstance().getArchivePolicy();
+    QHBoxLayout *archiveLayout = new QHBoxLayout();
+    archiveLayout->addWidget(new QLabel("Архивировать заказы старше (мес.):"));
+    m_archiveHorizonSpin = new QSpinBox();
+    m_archiveHorizonSpin->setRange(1, 120);
+    m_archiveHorizonSpin->setValue(policy.horizonMonths);
+    archiveLayout->addWidget(m_archiveHorizonSpin);
+    m_autoArchiveCheck = new QCheckBox("Автоматически");
+    m_autoArchiveCheck->setChecked(policy.automatic);
+    archiveLayout->addWidget(m_autoArchiveCheck);
+    m_archiveButton = new QPushButton("Архивировать сейчас");
+    archiveLayout->addWidget(m_archiveButton);
+    archiveLayout->addStretch();
+    mainLayout->addLayout(archiveLayout);
+    
     // Таблица заказов
     m_ordersTable = new QTableWidget(0, 6, this);
     m_ordersTable->setHorizontalHeaderLabels({"ID", "Дата", "ID ученика", "Логин", "Блюда", "Сумма"});
@@ -202,13 +267,15 @@ void AdminWindow::setupOrdersTab()
     connect(m_filterUserEdit, &QLineEdit::textChanged, this, &AdminWindow::onFilterOrders);
     connect(m_clearFilterButton, &QPushButton::clicked, this, &AdminWindow::refreshOrders);
     connect(m_exportOrdersButton, &QPushButton::clicked, this, &AdminWindow::onExportOrders);
-    
-    m_tabWidget->addTab(m_ordersTab, "Заказы");
+    connect(m_importStudentsButton, &QPushButton::clicked, this, &AdminWindow::onImportStudents);
+    connect(m_archiveHorizonSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, &AdminWindow::onArchivePolicyChanged);
+    connect(m_autoArchiveCheck, &QCheckBox::toggled, this, &AdminWindow::onArchivePolicyChanged);
+    connect(m_archiveButton, &QPushButton::clicked, this, &AdminWindow::onArchiveOrders);
+
 }
 
 void AdminWindow::setupReportsTab()
 {
-    m_reportsTab = new QWidget();
     QVBoxLayout *mainLayout = new QVBoxLayout(m_reportsTab);
     
     QHBoxLayout *buttonLayout = new QHBoxLayout();
@@ -230,8 +297,46 @@ void AdminWindow::setupReportsTab()
     connect(m_revenueReportButton, &QPushButton::clicked, this, &AdminWindow::onGenerateRevenueReport);
     connect(m_popularDishesReportButton, &QPushButton::clicked, this, &AdminWindow::onGeneratePopularDishesReport);
     connect(m_ordersByDateReportButton, &QPushButton::clicked, this, &AdminWindow::onGenerateOrdersByDateReport);
+
+}
+
+void AdminWindow::setupDiagnosticsTab()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(m_diagnosticsTab);
     
-    m_tabWidget->addTab(m_reportsTab, "Отчеты");
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_refreshDiagnosticsButton = new QPushButton("Обновить");
+    m_resetDiagnosticsButton = new QPushButton("Сбросить");
+    m_dumpDiagnosticsButton = new QPushButton("Сохранить в JSON");
+    buttonLayout->addWidget(m_refreshDiagnosticsButton);
+    buttonLayout->addWidget(m_resetDiagnosticsButton);
+    buttonLayout->addWidget(m_dumpDiagnosticsButton);
+    buttonLayout->addStretch();
+    if (!PerfStats::isEnabled()) {
+        buttonLayout->addWidget(new QLabel("Замеры отключены при сборке (CANTEEN_PERF_STATS)"));
+    }
+    mainLayout->addLayout(buttonLayout);
+    
+    m_diagnosticsTable = new QTableWidget(0, 7, this);
+    m_diagnosticsTable->setHorizontalHeaderLabels(
+        {"Операция", "Вызовов", "Всего, мс", "Среднее, мкс", "p50, мкс", "p99, мкс", "Макс, мкс"});
+    m_diagnosticsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_diagnosticsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_diagnosticsTable->setSortingEnabled(true);
+    mainLayout->addWidget(m_diagnosticsTable, 2);
+    
+    // Память по коллекциям DataManager
+    m_memoryLabel = new QLabel();
+    mainLayout->addWidget(m_memoryLabel);
+    m_memoryTable = new QTableWidget(0, 3, this);
+    m_memoryTable->setHorizontalHeaderLabels({"Коллекция", "Элементов", "Объем, КБ"});
+    m_memoryTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_memoryTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mainLayout->addWidget(m_memoryTable, 1);
+    
+    connect(m_refreshDiagnosticsButton, &QPushButton::clicked, this, &AdminWindow::onRefreshDiagnostics);
+    connect(m_resetDiagnosticsButton, &QPushButton::clicked, this, &AdminWindow::onResetDiagnostics);
+    connect(m_dumpDiagnosticsButton, &QPushButton::clicked, this, &AdminWindow::onDumpDiagnostics);
 }
 
 void AdminWindow::loadCategories()
@@ -246,29 +351,37 @@ void AdminWindow::loadCategories()
 
 void AdminWindow::loadMeals()
 {
+    PERF_SCOPE("AdminWindow::loadMeals");
     m_isLoadingMeals = true;
     
     DataManager &dm = DataManager::getInstance();
-    QList<Meal> meals = dm.getMeals();
+    quint64 version = 0;
+    const QList<Meal> meals = dm.getMeals(&version);
     
+    QList<int> indices;
     if (m_sortStrategy) {
-        meals = m_sortStrategy->sort(meals);
+        indices = m_sortStrategy->sortIndices(meals, version);
+    } else {
+        indices.resize(meals.size());
+        for (int i = 0; i < indices.size(); ++i) {
+            indices[i] = i;
+        }
     }
     
-    m_mealsTable->setRowCount(meals.size());
+    m_mealsTable->setRowCount(indices.size());
     
-    for (int i = 0; i < meals.size(); ++i) {
-        const Meal &meal = meals[i];
+    for (int i = 0; i < indices.size(); ++i) {
+        const Meal &meal = meals[indices[i]];
         QTableWidgetItem *idItem = new QTableWidgetItem(QString::number(meal.getId()));
         idItem->setFlags(idItem->flags() & ~Qt::ItemIsEditable);
         m_mealsTable->setItem(i, 0, idItem);
         
         m_mealsTable->setItem(i, 1, new QTableWidgetItem(meal.getName()));
         
-        QTableWidgetItem *priceItem = new QTableWidgetItem(QString::number(meal.getPrice(), 'f', 2));
+        QTableWidgetItem *priceItem = new QTableWidgetItem(meal.getPrice().toString());
         m_mealsTable->setItem(i, 2, priceItem);
         
-        Category *cat = dm.getCategoryById(meal.getCategoryId());
+        std::optional<Category> cat = dm.getCategoryById(meal.getCategoryId());
         QString catName = cat ? cat->getName() : "Неизвестно";
         QTableWidgetItem *catItem = new QTableWidgetItem(catName);
         catItem->setData(Qt::UserRole, meal.getCategoryId());
@@ -282,8 +395,11 @@ void AdminWindow::loadMeals()
 
 void AdminWindow::loadOrders()
 {
+    PERF_SCOPE("AdminWindow::loadOrders");
     DataManager &dm = DataManager::getInstance();
-    QList<Order> orders = dm.getOrders();
+    // Без фильтра показываем текущий месяц: он уже загружен, старые месяцы не читаются с диска
+    const QDate today = QDate::currentDate();
+    QList<Order> orders = dm.getOrdersInRange(QDate(today.year(), today.month(), 1), today);
     
     m_filteredOrders = orders;
     
@@ -295,13 +411,13 @@ void AdminWindow::loadOrders()
         m_ordersTable->setItem(i, 1, new QTableWidgetItem(order.getDate().toString("dd.MM.yyyy")));
         m_ordersTable->setItem(i, 2, new QTableWidgetItem(QString::number(order.getUserId())));
         
-        User *user = dm.getUserById(order.getUserId());
+        std::optional<User> user = dm.getUserById(order.getUserId());
         QString username = user ? user->getUsername() : "Неизвестно";
         m_ordersTable->setItem(i, 3, new QTableWidgetItem(username));
         
         QString mealsStr;
         for (const auto &mealPair : order.getMeals()) {
-            Meal *meal = dm.getMealById(mealPair.first);
+            std::optional<Meal> meal = dm.getMealById(mealPair.first);
             if (meal) {
                 mealsStr += QString("%1 (x%2), ").arg(meal->getName()).arg(mealPair.second);
             }
@@ -310,7 +426,7 @@ void AdminWindow::loadOrders()
             mealsStr.chop(2);
         }
         m_ordersTable->setItem(i, 4, new QTableWidgetItem(mealsStr));
-        m_ordersTable->setItem(i, 5, new QTableWidgetItem(QString::number(order.getTotalPrice(), 'f', 2) + " руб."));
+        m_ordersTable->setItem(i, 5, new QTableWidgetItem(order.getTotalPrice().toString() + " руб."));
     }
     
     m_ordersTable->setColumnWidth(4, 300);
@@ -334,10 +450,10 @@ void AdminWindow::onMealSelectionChanged()
     if (hasSelection) {
         int mealId = getSelectedMealId();
         DataManager &dm = DataManager::getInstance();
-        Meal *meal = dm.getMealById(mealId);
+        std::optional<Meal> meal = dm.getMealById(mealId);
         if (meal) {
             m_mealNameEdit->setText(meal->getName());
-            m_mealPriceSpin->setValue(meal->getPrice());
+            m_mealPriceSpin->setValue(meal->getPrice().toRubles());
             
             int index = m_mealCategoryCombo->findData(meal->getCategoryId());
             if (index >= 0) {
@@ -365,7 +481,7 @@ void AdminWindow::onMealSelectionChanged()
 void AdminWindow::onAddMeal()
 {
     QString name = m_mealNameEdit->text().trimmed();
-    double price = m_mealPriceSpin->value();
+    Money price = Money::fromRubles(m_mealPriceSpin->value());
     int categoryId = m_mealCategoryCombo->currentData().toInt();
     QString imagePath = m_mealImagePathEdit->text().trimmed();
     
@@ -388,7 +504,7 @@ void AdminWindow::onEditMeal()
     if (mealId < 0) return;
     
     QString name = m_mealNameEdit->text().trimmed();
-    double price = m_mealPriceSpin->value();
+    Money price = Money::fromRubles(m_mealPriceSpin->value());
     int categoryId = m_mealCategoryCombo->currentData().toInt();
     QString imagePath = m_mealImagePathEdit->text().trimmed();
     
@@ -398,7 +514,7 @@ void AdminWindow::onEditMeal()
     }
     
     DataManager &dm = DataManager::getInstance();
-    Meal *meal = dm.getMealById(mealId);
+    std::optional<Meal> meal = dm.getMealById(mealId);
     if (meal) {
         meal->setName(name);
         meal->setPrice(price);
@@ -436,10 +552,10 @@ void AdminWindow::refreshOrders()
 
 void AdminWindow::onFilterOrders()
 {
+    PERF_SCOPE("AdminWindow::onFilterOrders");
     DataManager &dm = DataManager::getInstance();
-    QList<Order> orders = dm.getOrders();
-    
     QDate filterDate = m_filterDateEdit->date();
+    QList<Order> orders = filterDate.isValid() ? dm.getOrdersByDate(filterDate) : dm.getOrders();
     QString userFilterStr = m_filterUserEdit->text().trimmed();
     
     QList<Order> filtered;
@@ -460,7 +576,7 @@ void AdminWindow::onFilterOrders()
             }
             
             if (!matchesUser) {
-                User *user = dm.getUserById(order.getUserId());
+                std::optional<User> user = dm.getUserById(order.getUserId());
                 if (user && user->getUsername().contains(userFilterStr, Qt::CaseInsensitive)) {
                     matchesUser = true;
                 }
@@ -486,13 +602,13 @@ void AdminWindow::onFilterOrders()
         m_ordersTable->setItem(i, 1, new QTableWidgetItem(order.getDate().toString("dd.MM.yyyy")));
         m_ordersTable->setItem(i, 2, new QTableWidgetItem(QString::number(order.getUserId())));
         
-        User *user = dm.getUserById(order.getUserId());
+        std::optional<User> user = dm.getUserById(order.getUserId());
         QString username = user ? user->getUsername() : "Неизвестно";
         m_ordersTable->setItem(i, 3, new QTableWidgetItem(username));
         
         QString mealsStr;
         for (const auto &mealPair : order.getMeals()) {
-            Meal *meal = dm.getMealById(mealPair.first);
+            std::optional<Meal> meal = dm.getMealById(mealPair.first);
             if (meal) {
                 mealsStr += QString("%1 (x%2), ").arg(meal->getName()).arg(mealPair.second);
             }
@@ -501,7 +617,7 @@ void AdminWindow::onFilterOrders()
             mealsStr.chop(2);
         }
         m_ordersTable->setItem(i, 4, new QTableWidgetItem(mealsStr));
-        m_ordersTable->setItem(i, 5, new QTableWidgetItem(QString::number(order.getTotalPrice(), 'f', 2) + " руб."));
+        m_ordersTable->setItem(i, 5, new QTableWidgetItem(order.getTotalPrice().toString() + " руб."));
     }
     
     m_ordersTable->setColumnWidth(4, 300);
@@ -511,7 +627,8 @@ void AdminWindow::onGenerateRevenueReport()
 {
     DataManager &dm = DataManager::getInstance();
     m_reportManager->setStrategy(new RevenueReportStrategy());
-    QString report = m_reportManager->generateReport(dm.getOrders(), dm.getMeals(), dm.getUsers());
+    m_reportManager->setArchive(dm.getArchive());
+    QString report = m_reportManager->generateReport(dm.getOrderColumns(), dm.getMeals(), dm.getUsers());
     m_reportText->setPlainText(report);
 }
 
@@ -519,7 +636,8 @@ void AdminWindow::onGeneratePopularDishesReport()
 {
     DataManager &dm = DataManager::getInstance();
     m_reportManager->setStrategy(new PopularDishesReportStrategy());
-    QString report = m_reportManager->generateReport(dm.getOrders(), dm.getMeals(), dm.getUsers());
+    m_reportManager->setArchive(dm.getArchive());
+    QString report = m_reportManager->generateReport(dm.getOrderColumns(), dm.getMeals(), dm.getUsers());
     m_reportText->setPlainText(report);
 }
 
@@ -527,7 +645,8 @@ void AdminWindow::onGenerateOrdersByDateReport()
 {
     DataManager &dm = DataManager::getInstance();
     m_reportManager->setStrategy(new OrdersByDateReportStrategy());
-    QString report = m_reportManager->generateReport(dm.getOrders(), dm.getMeals(), dm.getUsers());
+    m_reportManager->setArchive(dm.getArchive());
+    QString report = m_reportManager->generateReport(dm.getOrderColumns(), dm.getMeals(), dm.getUsers());
     m_reportText->setPlainText(report);
 }
 
@@ -551,109 +670,172 @@ void AdminWindow::onExportOrders()
         return;
     }
     
-    QString filename = QFileDialog::getSaveFileName(this, "Экспорт заказов", "", "JSON Files (*.json)");
+    QString filename = QFileDialog::getSaveFileName(this, "Экспорт заказов", "",
+        "JSON Files (*.json);;NDJSON Files (*.ndjson *.jsonl);;CSV Files (*.csv)");
     if (filename.isEmpty()) {
         return;
     }
     
+    // Экспорт работает с копиями, чтобы рабочий поток не обращался к DataManager
     DataManager &dm = DataManager::getInstance();
-    QJsonArray ordersArray;
-    
-    for (const Order &order : m_filteredOrders) {
-        QJsonObject orderObj;
-        orderObj["id"] = order.getId();
-        orderObj["userId"] = order.getUserId();
-        orderObj["date"] = order.getDate().toString(Qt::ISODate);
-        orderObj["totalPrice"] = order.getTotalPrice();
-        
-        // Добавляем информацию о пользователе
-        User *user = dm.getUserById(order.getUserId());
-        if (user) {
-            QJsonObject userObj;
-            userObj["id"] = user->getId();
-            userObj["username"] = user->getUsername();
-            orderObj["user"] = userObj;
+    auto exporter = std::make_shared<OrderExporter>(dm.getUsers(), dm.getMeals(), dm.getCategories());
+    const QList<Order> orders = m_filteredOrders;
+    const OrderExporter::Format format = OrderExporter::formatForFile(filename);
+    
+    QProgressDialog *progressDialog = new QProgressDialog("Экспорт заказов...", "Отмена", 0, int(orders.size()), this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    auto success = std::make_shared<bool>(false);
+    auto errorMessage = std::make_shared<QString>();
+    connect(progressDialog, &QProgressDialog::canceled, this, [cancelled]() {
+        cancelled->store(true);
+    });
+    
+    QPointer<QProgressDialog> dialogGuard(progressDialog);
+    QThread *worker = QThread::create([=]() {
+        QSaveFile file(filename);
+        if (!file.open(QIODevice::WriteOnly)) {
+            *errorMessage = file.errorString();
+            return;
         }
-        
-        // Добавляем информацию о блюдах
-        QJsonArray mealsArray;
-        for (const auto &mealPair : order.getMeals()) {
-            Meal *meal = dm.getMealById(mealPair.first);
-            if (meal) {
-                QJsonObject mealObj;
-                mealObj["id"] = meal->getId();
-                mealObj["name"] = meal->getName();
-                mealObj["price"] = meal->getPrice();
-                mealObj["quantity"] = mealPair.second;
-                
-                // Добавляем информацию о категории
-                Category *category = dm.getCategoryById(meal->getCategoryId());
-                if (category) {
-                    QJsonObject categoryObj;
-                    categoryObj["id"] = category->getId();
-                    categoryObj["name"] = category->getName();
-                    mealObj["category"] = categoryObj;
+        auto progress = [=](qsizetype done, qsizetype) {
+            QMetaObject::invokeMethod(qApp, [dialogGuard, done]() {
+                if (dialogGuard) {
+                    dialogGuard->setValue(int(done));
                 }
-                
-                mealsArray.append(mealObj);
-            }
+            }, Qt::QueuedConnection);
+            return !cancelled->load();
+        };
+        if (!exporter->exportOrders(orders, &file, format, progress, errorMessage.get())) {
+            file.cancelWriting();
+            return;
         }
-        orderObj["meals"] = mealsArray;
-        
-        ordersArray.append(orderObj);
+        *success = file.commit();
+        if (!*success) {
+            *errorMessage = file.errorString();
+        }
+    });
+    
+    m_exportOrdersButton->setEnabled(false);
+    connect(worker, &QThread::finished, this, [=]() {
+        worker->deleteLater();
+        m_exportOrdersButton->setEnabled(true);
+        if (dialogGuard) {
+            dialogGuard->close();
+        }
+        if (*success) {
+            QMessageBox::information(this, "Успех", 
+                QString("Заказы успешно экспортированы (%1 заказов)").arg(orders.size()));
+        } else if (!cancelled->load()) {
+            qWarning() << "Order export failed:" << *errorMessage;
+            QMessageBox::warning(this, "Ошибка", "Не удалось сохранить файл: " + *errorMessage);
+        }
+    });
+    worker->start();
+}
+
+void AdminWindow::onImportStudents()
+{
+    QString filename = QFileDialog::getOpenFileName(this, "Импорт учеников", "",
+        "Списки учеников (*.csv *.json);;CSV Files (*.csv);;JSON Files (*.json)");
+    if (filename.isEmpty()) {
+        return;
     }
     
-    QJsonObject rootObj;
-    rootObj["orders"] = ordersArray;
-    rootObj["totalOrders"] = ordersArray.size();
-    rootObj["exportDate"] = QDate::currentDate().toString(Qt::ISODate);
+    if (DataManager::getInstance().isReadOnly()) {
+        QMessageBox::warning(this, "Ошибка", "Регистрация доступна только на компьютере с сервисом заказов");
+        return;
+    }
     
-    QJsonDocument doc(rootObj);
+    QProgressDialog *progressDialog = new QProgressDialog("Регистрация учеников...", QString(), 0, 0, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(500);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    QPointer<QProgressDialog> dialogGuard(progressDialog);
+    
+    // Чтение и хэширование паролей - в рабочем потоке, регистрация - одной транзакцией
+    auto result = std::make_shared<RosterImportResult>();
+    QThread *worker = QThread::create([=]() {
+        QList<RosterEntry> entries = RosterImport::readFile(filename, &result->errors);
+        if (entries.isEmpty()) {
+            return;
+        }
+        RosterImport::hashPasswords(entries);
+        const QStringList parseErrors = result->errors;
+        *result = DataManager::getInstance().addStudents(entries);
+        result->errors = parseErrors + result->errors;
+    });
     
-    QFile file(filename);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson(QJsonDocument::Indented));
-        file.close();
-        QMessageBox::information(this, "Успех", 
-            QString("Заказы успешно экспортированы (%1 заказов)").arg(m_filteredOrders.size()));
-    } else {
-        QMessageBox::warning(this, "Ошибка", "Не удалось сохранить файл");
-    }
+    m_importStudentsButton->setEnabled(false);
+    connect(worker, &QThread::finished, this, [=]() {
+        worker->deleteLater();
+        m_importStudentsButton->setEnabled(true);
+        if (dialogGuard) {
+            dialogGuard->close();
+        }
+        
+        QString text = QString("Зарегистрировано учеников: %1").arg(result->added);
+        if (!result->duplicates.isEmpty()) {
+            text += QString("\nПропущено (логин уже занят): %1").arg(result->duplicates.size());
+        }
+        if (!result->errors.isEmpty()) {
+            text += QString("\nСтрок с ошибками: %1").arg(result->errors.size());
+        }
+        QMessageBox box(result->added > 0 ? QMessageBox::Information : QMessageBox::Warning,
+                        "Импорт учеников", text, QMessageBox::Ok, this);
+        const QStringList details = result->errors + result->duplicates;
+        if (!details.isEmpty()) {
+            box.setDetailedText(details.join("\n"));
+        }
+        box.exec();
+    });
+    worker->start();
 }
 
 void AdminWindow::onImportMenu()
 {
     QString filename = QFileDialog::getOpenFileName(this, "Импорт меню", "", "JSON Files (*.json)");
-    if (!filename.isEmpty()) {
-        DataManager &dm = DataManager::getInstance();
-        if (dm.importMenu(filename)) {
-            QMessageBox::information(this, "Успех", "Меню успешно импортировано");
-            loadCategories();
-            refreshMeals();
-        } else {
-            QMessageBox::warning(this, "Ошибка", "Не удалось импортировать меню");
-        }
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    DataManager &dm = DataManager::getInstance();
+    const MenuImportPlan plan = dm.planMenuImport(filename);
+    if (!plan.isValid()) {
+        QMessageBox box(QMessageBox::Warning, "Ошибка",
+                        QString("Файл меню содержит ошибки (%1), импорт отменен").arg(plan.errors.size()),
+                        QMessageBox::Ok, this);
+        box.setDetailedText(plan.errors.join("\n"));
+        box.exec();
+        return;
+    }
+    if (!plan.hasChanges()) {
+        QMessageBox::information(this, "Импорт меню", "Меню в файле совпадает с текущим\n" + plan.summary());
+        return;
+    }
+    
+    if (QMessageBox::question(this, "Импорт меню", plan.summary() + "\n\nПрименить изменения?")
+        != QMessageBox::Yes) {
+        return;
+    }
+    
+    QString errorMessage;
+    if (dm.applyMenuImport(plan, &errorMessage)) {
+        QMessageBox::information(this, "Успех", "Меню успешно импортировано");
+        loadCategories();
+        refreshMeals();
+    } else {
+        QMessageBox::warning(this, "Ошибка", "Не удалось импортировать меню: " + errorMessage);
     }
 }
 
 void AdminWindow::onSortMealsChanged()
 {
-    int index = m_sortCombo->currentData().toInt();
-    delete m_sortStrategy;
-    
-    switch (index) {
-    case 0:
-        m_sortStrategy = new SortByNameStrategy();
-        break;
-    case 1:
-        m_sortStrategy = new SortByPriceAscendingStrategy();
-        break;
-    case 2:
-        m_sortStrategy = new SortByPriceDescendingStrategy();
-        break;
-    default:
-        m_sortStrategy = nullptr;
-    }
+    int id = m_sortCombo->currentData().toInt();
+    m_sortStrategy = SortStrategyRegistry::getInstance().strategy(id);
     
     refreshMeals();
 }
@@ -667,7 +849,7 @@ void AdminWindow::onMealCellChanged(int row, int column)
     
     int mealId = idItem->text().toInt();
     DataManager &dm = DataManager::getInstance();
-    Meal *meal = dm.getMealById(mealId);
+    std::optional<Meal> meal = dm.getMealById(mealId);
     if (!meal) return;
     
     bool changed = false;
@@ -685,8 +867,8 @@ void AdminWindow::onMealCellChanged(int row, int column)
         QTableWidgetItem *priceItem = m_mealsTable->item(row, column);
         if (priceItem) {
             bool ok;
-            double newPrice = priceItem->text().toDouble(&ok);
-            if (ok && newPrice >= 0 && qAbs(newPrice - meal->getPrice()) > 0.01) {
+            Money newPrice = Money::fromRubles(priceItem->text().toDouble(&ok));
+            if (ok && !newPrice.isNegative() && newPrice != meal->getPrice()) {
                 meal->setPrice(newPrice);
                 changed = true;
             }
@@ -755,3 +937,115 @@ void AdminWindow::clearMealForm()
     m_imagePreview->clear();
 }
 
+void AdminWindow::onRefreshDiagnostics()
+{
+    const QList<PerfStats::SiteSnapshot> sites = PerfStats::snapshot();
+    
+    // Сортировка по щелчку на заголовке мешает заполнению строк
+    m_diagnosticsTable->setSortingEnabled(false);
+    m_diagnosticsTable->setRowCount(sites.size());
+    auto numberItem = [](double value, int precision) {
+        QTableWidgetItem *item = new QTableWidgetItem();
+        item->setData(Qt::DisplayRole, QString::number(value, 'f', precision).toDouble());
+        return item;
+    };
+    for (int row = 0; row < sites.size(); ++row) {
+        const PerfStats::SiteSnapshot &site = sites[row];
+        m_diagnosticsTable->setItem(row, 0, new QTableWidgetItem(site.name));
+        m_diagnosticsTable->setItem(row, 1, numberItem(double(site.count), 0));
+        if (site.counter) {
+            // Для счетчиков - сумма значений, остальные колонки не заполняются
+            m_diagnosticsTable->setItem(row, 2, numberItem(double(site.total), 0));
+            for (int column = 3; column < m_diagnosticsTable->columnCount(); ++column) {
+                m_diagnosticsTable->setItem(row, column, new QTableWidgetItem());
+            }
+            continue;
+        }
+        m_diagnosticsTable->setItem(row, 2, numberItem(double(site.total) / 1e6, 2));
+        m_diagnosticsTable->setItem(row, 3, numberItem(site.meanNs() / 1e3, 1));
+        m_diagnosticsTable->setItem(row, 4, numberItem(double(site.percentileNs(50)) / 1e3, 1));
+        m_diagnosticsTable->setItem(row, 5, numberItem(double(site.percentileNs(99)) / 1e3, 1));
+        m_diagnosticsTable->setItem(row, 6, numberItem(double(site.max) / 1e3, 1));
+    }
+    m_diagnosticsTable->setSortingEnabled(true);
+    
+    const MemoryReport memory = DataManager::getInstance().getMemoryReport();
+    auto megabytes = [](qint64 bytes) {
+        return bytes > 0 ? QString::number(double(bytes) / (1024 * 1024), 'f', 1) + " МБ" : QString("н/д");
+    };
+    m_memoryLabel->setText(QString("Оценка коллекций: %1, отображено архивов: %2; RSS: %3, пик: %4, "
+                                   "пик при загрузке: %5, пик последнего сохранения: %6")
+                               .arg(megabytes(memory.totalBytes()), megabytes(memory.mappedBytes),
+                                    megabytes(memory.currentRss), megabytes(memory.peakRss),
+                                    megabytes(memory.peakRssAfterLoad), megabytes(memory.peakRssLastSave)));
+    m_memoryTable->setRowCount(memory.items.size());
+    for (int row = 0; row < memory.items.size(); ++row) {
+        const MemoryUsageItem &item = memory.items[row];
+        m_memoryTable->setItem(row, 0, new QTableWidgetItem(item.name));
+        m_memoryTable->setItem(row, 1, new QTableWidgetItem(QString::number(item.count)));
+        m_memoryTable->setItem(row, 2, new QTableWidgetItem(QString::number(double(item.bytes) / 1024, 'f', 1)));
+    }
+}
+
+void AdminWindow::onResetDiagnostics()
+{
+    PerfStats::reset();
+    onRefreshDiagnostics();
+}
+
+void AdminWindow::onDumpDiagnostics()
+{
+    QString filename = QFileDialog::getSaveFileName(this, "Сохранить замеры", "perfstats.json", "JSON Files (*.json)");
+    if (filename.isEmpty()) {
+        return;
+    }
+    
+    QString errorMessage;
+    if (!PerfStats::dumpToFile(filename, &errorMessage)) {
+        QMessageBox::warning(this, "Ошибка", "Не удалось сохранить файл: " + errorMessage);
+    }
+}
+
+void AdminWindow::onArchivePolicyChanged()
+{
+    ArchivePolicy policy;
+    policy.horizonMonths = m_archiveHorizonSpin->value();
+    policy.automatic = m_autoArchiveCheck->isChecked();
+    DataManager::getInstance().setArchivePolicy(policy);
+}
+
+void AdminWindow::onArchiveOrders()
+{
+    const int months = m_archiveHorizonSpin->value();
+    int ret = QMessageBox::question(this, "Архивация",
+                                    QString("Перенести в архив заказы старше %1 мес.?\n"
+                                            "Архивные заказы доступны только для просмотра и отчетов.").arg(months),
+                                    QMessageBox::Yes | QMessageBox::No);
+    if (ret != QMessageBox::Yes) {
+        return;
+    }
+    
+    onArchivePolicyChanged();
+    QString error;
+    int archived = DataManager::getInstance().archiveExpiredOrders(&error);
+    if (archived < 0) {
+        QMessageBox::warning(this, "Ошибка", "Не удалось архивировать заказы: " + error);
+        return;
+    }
+    
+    QMessageBox::information(this, "Архивация", QString("Перенесено в архив месяцев: %1").arg(archived));
+    loadOrders();
+}
+
+void AdminWindow::onScheduledArchive()
+{
+    DataManager &dm = DataManager::getInstance();
+    if (!dm.getArchivePolicy().automatic) {
+        return;
+    }
+    
+    QString error;
+    if (dm.archiveExpiredOrders(&error) < 0) {
+        qWarning() << "Scheduled archival failed:" << error;
+    }
+}
@@ -17,6 +17,10 @@
 #include <QHeaderView>
 #include <QAbstractItemView>
 #include <QCloseEvent>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QTimer>
+#include <QSet>
 #include "user.h"
 #include "meal.h"
 #include "order.h"
@@ -50,8 +54,16 @@ private slots:
     void onExportMenu();
     void onImportMenu();
     void onExportOrders();
+    void onImportStudents();
     void onSortMealsChanged();
     void onMealCellChanged(int row, int column);
+    void onArchiveOrders();
+    void onArchivePolicyChanged();
+    void onScheduledArchive();
+    void onRefreshDiagnostics();
+    void onResetDiagnostics();
+    void onDumpDiagnostics();
+    void ensureTabLoaded(int index);
 
 private:
     User *m_user;
@@ -60,6 +72,7 @@ private:
     bool m_isLoadingMeals;
     
     QTabWidget *m_tabWidget;
+    QSet<QWidget *> m_loadedTabs;
     
     // Tab 1: Управление меню
     QWidget *m_menuTab;
@@ -84,6 +97,11 @@ private:
     QLineEdit *m_filterUserEdit;
     QPushButton *m_clearFilterButton;
     QPushButton *m_exportOrdersButton;
+    QPushButton *m_importStudentsButton;
+    QSpinBox *m_archiveHorizonSpin;
+    QCheckBox *m_autoArchiveCheck;
+    QPushButton *m_archiveButton;
+    QTimer *m_archiveTimer;
     QList<Order> m_filteredOrders;
     
     // Tab 3: Отчеты
@@ -93,10 +111,20 @@ private:
     QPushButton *m_popularDishesReportButton;
     QPushButton *m_ordersByDateReportButton;
     
+    // Tab 4: Диагностика
+    QWidget *m_diagnosticsTab;
+    QTableWidget *m_diagnosticsTable;
+    QTableWidget *m_memoryTable;
+    QLabel *m_memoryLabel;
+    QPushButton *m_refreshDiagnosticsButton;
+    QPushButton *m_resetDiagnosticsButton;
+    QPushButton *m_dumpDiagnosticsButton;
+    
     void setupUI();
     void setupMenuTab();
     void setupOrdersTab();
     void setupReportsTab();
+    void setupDiagnosticsTab();
     void loadCategories();
     void loadMeals();
     void loadOrders();
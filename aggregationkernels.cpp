@@ -0,0 +1,311 @@
+#include "aggregationkernels.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define AGGREGATION_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace AggregationKernels {
+
+namespace {
+
+qint64 sumScalar(const qint64 *values, qsizetype n)
+{
+    qint64 total = 0;
+    for (qsizetype i = 0; i < n; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+bool minMaxScalar(const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue)
+{
+    qint32 lo = std::numeric_limits<qint32>::max();
+    qint32 hi = std::numeric_limits<qint32>::min();
+    bool found = false;
+    for (qsizetype i = 0; i < n; ++i) {
+        if (values[i] != skipValue) {
+            lo = std::min(lo, values[i]);
+            hi = std::max(hi, values[i]);
+            found = true;
+        }
+    }
+    *minValue = lo;
+    *maxValue = hi;
+    return found;
+}
+
+#ifdef AGGREGATION_KERNELS_X86
+
+__attribute__((target("sse4.1")))
+qint64 sumSse41(const qint64 *values, qsizetype n)
+{
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    qsizetype i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_epi64(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)));
+        acc1 = _mm_add_epi64(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 2)));
+    }
+    acc0 = _mm_add_epi64(acc0, acc1);
+    qint64 total = _mm_cvtsi128_si64(acc0) + _mm_extract_epi64(acc0, 1);
+    for (; i < n; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+__attribute__((target("avx2")))
+qint64 sumAvx2(const qint64 *values, qsizetype n)
+{
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    qsizetype i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 4)));
+    }
+    acc0 = _mm256_add_epi64(acc0, acc1);
+    alignas(32) qint64 lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc0);
+    qint64 total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+__attribute__((target("sse4.1")))
+bool minMaxSse41(const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue)
+{
+    const __m128i skip = _mm_set1_epi32(skipValue);
+    const __m128i top = _mm_set1_epi32(std::numeric_limits<qint32>::max());
+    const __m128i bottom = _mm_set1_epi32(std::numeric_limits<qint32>::min());
+    __m128i lo = top;
+    __m128i hi = bottom;
+    __m128i anyFound = _mm_setzero_si128();
+    qsizetype i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+        const __m128i isSkip = _mm_cmpeq_epi32(v, skip);
+        lo = _mm_min_epi32(lo, _mm_blendv_epi8(v, top, isSkip));
+        hi = _mm_max_epi32(hi, _mm_blendv_epi8(v, bottom, isSkip));
+        anyFound = _mm_or_si128(anyFound, _mm_andnot_si128(isSkip, _mm_set1_epi32(-1)));
+    }
+    alignas(16) qint32 loLanes[4];
+    alignas(16) qint32 hiLanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(loLanes), lo);
+    _mm_store_si128(reinterpret_cast<__m128i *>(hiLanes), hi);
+    
+    qint32 tailMin;
+    qint32 tailMax;
+    bool found = minMaxScalar(values + i, n - i, skipValue, &tailMin, &tailMax);
+    found = found || !_mm_testz_si128(anyFound, anyFound);
+    *minValue = std::min({loLanes[0], loLanes[1], loLanes[2], loLanes[3], tailMin});
+    *maxValue = std::max({hiLanes[0], hiLanes[1], hiLanes[2], hiLanes[3], tailMax});
+    return found;
+}
+
+__attribute__((target("avx2")))
+bool minMaxAvx2(const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue)
+{
+    const __m256i skip = _mm256_set1_epi32(skipValue);
+    const __m256i top = _mm256_set1_epi32(std::numeric_limits<qint32>::max());
+    const __m256i bottom = _mm256_set1_epi32(std::numeric_limits<qint32>::min());
+    __m256i lo = top;
+    __m256i hi = bottom;
+    __m256i anyFound = _mm256_setzero_si256();
+    qsizetype i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        const __m256i isSkip = _mm256_cmpeq_epi32(v, skip);
+        lo = _mm256_min_epi32(lo, _mm256_blendv_epi8(v, top, isSkip));
+        hi = _mm256_max_epi32(hi, _mm256_blendv_epi8(v, bottom, isSkip));
+        anyFound = _mm256_or_si256(anyFound, _mm256_andnot_si256(isSkip, _mm256_set1_epi32(-1)));
+    }
+    alignas(32) qint32 loLanes[8];
+    alignas(32) qint32 hiLanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(loLanes), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(hiLanes), hi);
+    
+    qint32 tailMin;
+    qint32 tailMax;
+    bool found = minMaxScalar(values + i, n - i, skipValue, &tailMin, &tailMax);
+    found = found || !_mm256_testz_si256(anyFound, anyFound);
+    *minValue = std::min(tailMin, *std::min_element(loLanes, loLanes + 8));
+    *maxValue = std::max(tailMax, *std::max_element(hiLanes, hiLanes + 8));
+    return found;
+}
+
+#endif // AGGREGATION_KERNELS_X86
+
+// Разброс по корзинам (scatter) не векторизуется на SSE/AVX2, поэтому он общий для всех путей
+// (замеры - в aggregationkernels.h).
+// Заказы лежат по дням подряд, и одинаковые ключи подряд образуют цепочку зависимостей
+// через память; для небольших таблиц ее разрывают четыре частичные таблицы.
+constexpr qsizetype kPartialTableLimit = 4096;
+
+template <typename Out, typename ValueAt>
+void scatterAdd(const qint32 *keys, qsizetype n, qint32 firstKey,
+                Out *out, qsizetype outSize, ValueAt valueAt)
+{
+    const auto slotOf = [firstKey](qint32 key) {
+        return static_cast<quint64>(static_cast<qint64>(key) - firstKey);
+    };
+    const quint64 limit = static_cast<quint64>(outSize);
+    
+    if (outSize > kPartialTableLimit || n < 4 * outSize) {
+        for (qsizetype i = 0; i < n; ++i) {
+            const quint64 slot = slotOf(keys[i]);
+            if (slot < limit) {
+                out[slot] += valueAt(i);
+            }
+        }
+        return;
+    }
+    
+    std::vector<Out> partial(4 * outSize, 0);
+    Out *tables[4] = { partial.data(), partial.data() + outSize,
+                       partial.data() + 2 * outSize, partial.data() + 3 * outSize };
+    qsizetype i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int lane = 0; lane < 4; ++lane) {
+            const quint64 slot = slotOf(keys[i + lane]);
+            if (slot < limit) {
+                tables[lane][slot] += valueAt(i + lane);
+            }
+        }
+    }
+    for (; i < n; ++i) {
+        const quint64 slot = slotOf(keys[i]);
+        if (slot < limit) {
+            tables[0][slot] += valueAt(i);
+        }
+    }
+    for (qsizetype k = 0; k < outSize; ++k) {
+        out[k] += tables[0][k] + tables[1][k] + tables[2][k] + tables[3][k];
+    }
+}
+
+struct Dispatch
+{
+    Isa isa;
+    qint64 (*sum)(const qint64 *, qsizetype);
+    bool (*minMax)(const qint32 *, qsizetype, qint32, qint32 *, qint32 *);
+};
+
+Dispatch dispatchFor(Isa isa)
+{
+    switch (isa) {
+#ifdef AGGREGATION_KERNELS_X86
+    case Isa::Avx2:
+        return { Isa::Avx2, sumAvx2, minMaxAvx2 };
+    case Isa::Sse41:
+        return { Isa::Sse41, sumSse41, minMaxSse41 };
+#endif
+    default:
+        break;
+    }
+    return { Isa::Scalar, sumScalar, minMaxScalar };
+}
+
+Dispatch selectDispatch()
+{
+    if (qgetenv("CANTEEN_SIMD") != "scalar") {
+        for (Isa isa : { Isa::Avx2, Isa::Sse41 }) {
+            if (isaSupported(isa)) {
+                return dispatchFor(isa);
+            }
+        }
+    }
+    return dispatchFor(Isa::Scalar);
+}
+
+const Dispatch &dispatch()
+{
+    static const Dispatch selected = selectDispatch();
+    return selected;
+}
+
+}
+
+Isa activeIsa()
+{
+    return dispatch().isa;
+}
+
+const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Avx2:
+        return "AVX2";
+    case Isa::Sse41:
+        return "SSE4.1";
+    case Isa::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+bool isaSupported(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+#ifdef AGGREGATION_KERNELS_X86
+    case Isa::Avx2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case Isa::Sse41:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.1");
+#endif
+    default:
+        break;
+    }
+    return false;
+}
+
+qint64 sum(const qint64 *values, qsizetype n)
+{
+    return dispatch().sum(values, n);
+}
+
+bool minMax(const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue)
+{
+    return dispatch().minMax(values, n, skipValue, minValue, maxValue);
+}
+
+qint64 sum(Isa isa, const qint64 *values, qsizetype n)
+{
+    return dispatchFor(isa).sum(values, n);
+}
+
+bool minMax(Isa isa, const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue)
+{
+    return dispatchFor(isa).minMax(values, n, skipValue, minValue, maxValue);
+}
+
+void groupedSum(const qint32 *keys, const qint64 *values, qsizetype n,
+                qint32 firstKey, qint64 *out, qsizetype outSize)
+{
+    scatterAdd(keys, n, firstKey, out, outSize, [values](qsizetype i) { return values[i]; });
+}
+
+void groupedCount(const qint32 *keys, qsizetype n,
+                  qint32 firstKey, qint32 *out, qsizetype outSize)
+{
+    scatterAdd(keys, n, firstKey, out, outSize, [](qsizetype) { return qint32(1); });
+}
+
+void histogram(const qint32 *keys, const qint32 *weights, qsizetype n,
+               qint64 *out, qsizetype outSize)
+{
+    scatterAdd(keys, n, 0, out, outSize, [weights](qsizetype i) { return qint64(weights[i]); });
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef AGGREGATIONKERNELS_H
+#define AGGREGATIONKERNELS_H
+
+#include <QtGlobal>
+
+// Ядра агрегации для отчетов над колонками OrderColumns.
+// Реализация выбирается один раз при запуске (AVX2 / SSE4.1 / скалярная);
+// все вычисления целочисленные, поэтому результат не зависит от выбранного пути.
+// Переменная окружения CANTEEN_SIMD=scalar принудительно включает скалярный путь.
+// Векторные пути есть только у sum и minMax. groupedSum, groupedCount и histogram оставлены
+// скалярными намеренно: в SSE4.1/AVX2 нет записи по индексам (scatter), а векторный расчет
+// ячеек с последующей скалярной записью на 1 млн заказов медленнее скалярного ядра с
+// частичными таблицами (дни подряд, 365 ячеек: 1.35 мс против 1.09 мс; блюда вразброс,
+// 200 ячеек: 2.0 мс против 1.1 мс).
+namespace AggregationKernels {
+
+enum class Isa { Scalar, Sse41, Avx2 };
+
+Isa activeIsa();
+const char *isaName(Isa isa);
+// Поддерживает ли процессор путь isa (скалярный - всегда)
+bool isaSupported(Isa isa);
+
+// Сумма массива
+qint64 sum(const qint64 *values, qsizetype n);
+
+// Минимум и максимум, пропуская элементы, равные skipValue.
+// Возвращает false, если подходящих элементов нет.
+bool minMax(const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue);
+
+// То же через явно выбранный путь - для сравнения путей в тестах; isa должен поддерживаться
+qint64 sum(Isa isa, const qint64 *values, qsizetype n);
+bool minMax(Isa isa, const qint32 *values, qsizetype n, qint32 skipValue, qint32 *minValue, qint32 *maxValue);
+
+// out[keys[i] - firstKey] += values[i]; ключи вне [firstKey, firstKey + outSize) пропускаются
+void groupedSum(const qint32 *keys, const qint64 *values, qsizetype n,
+                qint32 firstKey, qint64 *out, qsizetype outSize);
+
+// out[keys[i] - firstKey] += 1; ключи вне диапазона пропускаются
+void groupedCount(const qint32 *keys, qsizetype n,
+                  qint32 firstKey, qint32 *out, qsizetype outSize);
+
+// Гистограмма с весами: out[keys[i]] += weights[i]; ключи вне [0, outSize) пропускаются
+void histogram(const qint32 *keys, const qint32 *weights, qsizetype n,
+               qint64 *out, qsizetype outSize);
+
+}
+
+#endif // AGGREGATIONKERNELS_H
@@ -0,0 +1,594 @@
+// Бенчмарк для замеров оптимизаций: генерирует N заказов и печатает время и число
+// выделений памяти (malloc/calloc/realloc, включая выделения внутри Qt) для прежнего
+// и текущего пути. Прежний путь воспроизводится здесь же, рядом с замером.
+//
+//   canteen_bench lines [--orders N]   - доступ к позициям и названиям по значению и по ссылке,
+//                                        хранение позиций в QList и внутри Order
+//   canteen_bench reports [--orders N] [--threads T]
+//                                      - отчеты по строкам заказов и по колонкам (ядра агрегации),
+//                                        пропускная способность на поток при T потоках
+//   canteen_bench summary [--orders N] - сводки месяцев: QMap/QHash на каждый заказ и арена
+//   canteen_bench load [--orders N]    - загрузка N заказов старого формата и первое сохранение
+//   canteen_bench service [--orders N] [--clients C]
+//                                      - пропускная способность сервиса заказов при C киосках
+//                                        (по умолчанию 20000 заказов: каждый пакет - fsync)
+//
+// Ядра агрегации выбираются при запуске; скалярный путь для сравнения - CANTEEN_SIMD=scalar.
+#include "order.h"
+#include "meal.h"
+#include "user.h"
+#include "ordercolumns.h"
+#include "reportstrategy.h"
+#include "aggregationkernels.h"
+#include "orderpartitions.h"
+#include "scratcharena.h"
+#include "datamanager.h"
+#include "orderservice.h"
+#include "orderserviceclient.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QDir>
+#include <QHash>
+#include <QSet>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QMap>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#if defined(__has_feature)
+#if __has_feature(thread_sanitizer) || __has_feature(address_sanitizer)
+#define CANTEEN_BENCH_SANITIZER
+#endif
+#endif
+#if defined(__SANITIZE_THREAD__) || defined(__SANITIZE_ADDRESS__)
+#define CANTEEN_BENCH_SANITIZER
+#endif
+
+namespace {
+
+std::atomic<qint64> allocationCount{0};
+
+}
+
+// Подсчет выделений через обертки над malloc из glibc; под санитайзерами malloc
+// перехватывает сам санитайзер, и счетчик не ведется
+#if defined(__GLIBC__) && !defined(CANTEEN_BENCH_SANITIZER)
+#define CANTEEN_BENCH_COUNT_ALLOCATIONS
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+#endif
+
+namespace {
+
+constexpr int MealCount = 50;
+constexpr int UserCount = 500;
+
+struct Measurement
+{
+    qint64 nanoseconds = 0;
+    qint64 allocations = 0;
+};
+
+Measurement measure(const std::function<void()> &body)
+{
+    const qint64 allocationsBefore = allocationCount.load();
+    QElapsedTimer timer;
+    timer.start();
+    body();
+    Measurement result;
+    result.nanoseconds = timer.nsecsElapsed();
+    result.allocations = allocationCount.load() - allocationsBefore;
+    return result;
+}
+
+void print(const char *name, const Measurement &m, qint64 items)
+{
+#ifdef CANTEEN_BENCH_COUNT_ALLOCATIONS
+    std::printf("  %-44s %10.1f ms %12lld allocs %8.2f allocs/item\n", name, m.nanoseconds / 1e6,
+                static_cast<long long>(m.allocations), items ? double(m.allocations) / double(items) : 0.0);
+#else
+    Q_UNUSED(items);
+    std::printf("  %-44s %10.1f ms  (allocations not counted)\n", name, m.nanoseconds / 1e6);
+#endif
+}
+
+// Защита от выбрасывания результата оптимизатором (пишется и из рабочих потоков)
+std::atomic<qint64> sink{0};
+
+QList<Meal> generateMeals()
+{
+    QList<Meal> meals;
+    for (int id = 1; id <= MealCount; ++id) {
+        meals.append(Meal(id, QString("Блюдо %1").arg(id), Money::fromKopecks(5000 + id * 100), 1 + id % 3));
+    }
+    return meals;
+}
+
+// Заказы за 12 месяцев 2025 года, 1-4 позиции; генератор детерминирован
+QList<Order> generateOrders(qsizetype count, const QList<Meal> &meals)
+{
+    std::mt19937 random(20251019);
+    std::uniform_int_distribution<int> lineCount(1, 4);
+    std::uniform_int_distribution<int> mealIndex(0, int(meals.size()) - 1);
+    std::uniform_int_distribution<int> quantity(1, 3);
+    std::uniform_int_distribution<int> user(2, UserCount + 1);
+    std::uniform_int_distribution<int> day(0, 364);
+
+    const QDate firstDay(2025, 1, 1);
+    QList<Order> orders;
+    orders.reserve(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        OrderLines lines;
+        Money total;
+        const int n = lineCount(random);
+        for (int l = 0; l < n; ++l) {
+            const Meal &meal = meals[mealIndex(random)];
+            const int q = quantity(random);
+            lines.append(qMakePair(meal.getId(), q));
+            total = total + meal.getPrice() * q;
+        }
+        Order order(int(i) + 1, user(random), firstDay.addDays(day(random)), std::move(lines));
+        order.setTotalPrice(total);
+        orders.append(std::move(order));
+    }
+    return orders;
+}
+
+// Обход позиций заказов: геттеры отдают константные ссылки, а позиции хранятся
+// внутри Order (OrderLines); для сравнения - копии в отдельный QList, как раньше.
+void benchLines(qsizetype orderCount)
+{
+    const QList<Meal> meals = generateMeals();
+    const QList<Order> orders = generateOrders(orderCount, meals);
+    std::printf("lines: %lld orders\n", static_cast<long long>(orders.size()));
+
+    // Прежнее хранение: позиции в QList<OrderLine>, getMeals() отдает его копию
+    // (неявное разделение: атомарный счетчик ссылок на каждый вызов)
+    QList<QList<OrderLine>> listLines;
+    listLines.reserve(orders.size());
+    for (const Order &order : orders) {
+        listLines.append(QList<OrderLine>(order.getMeals().cbegin(), order.getMeals().cend()));
+    }
+    auto linesOf = [&listLines](qsizetype i) { return listLines[i]; };
+    auto linesRefOf = [&listLines](qsizetype i) -> const QList<OrderLine> & { return listLines[i]; };
+
+    print("order lines by value (before)", measure([&]() {
+        qint64 quantities = 0;
+        for (qsizetype i = 0; i < listLines.size(); ++i) {
+            const QList<OrderLine> lines = linesOf(i);
+            for (const OrderLine &line : lines) {
+                quantities += line.second;
+            }
+        }
+        sink = quantities;
+    }), orders.size());
+    print("order lines by const reference (after)", measure([&]() {
+        qint64 quantities = 0;
+        for (qsizetype i = 0; i < listLines.size(); ++i) {
+            for (const OrderLine &line : linesRefOf(i)) {
+                quantities += line.second;
+            }
+        }
+        sink = quantities;
+    }), orders.size());
+
+    // Название блюда на каждую позицию, как при выводе заказов в таблицу
+    print("meal names by value (before)", measure([&]() {
+        qint64 length = 0;
+        for (const Order &order : orders) {
+            for (const OrderLine &line : order.getMeals()) {
+                const QString name = meals[line.first - 1].getName();
+                length += name.size();
+            }
+        }
+        sink = length;
+    }), orders.size());
+    print("meal names by const reference (after)", measure([&]() {
+        qint64 length = 0;
+        for (const Order &order : orders) {
+            for (const OrderLine &line : order.getMeals()) {
+                length += meals[line.first - 1].getName().size();
+            }
+        }
+        sink = length;
+    }), orders.size());
+
+    // Сборка заказов: отдельное выделение под QList позиций против встроенного буфера
+    print("build lines as QList<OrderLine> (before)", measure([&]() {
+        QList<QList<OrderLine>> built;
+        built.reserve(orders.size());
+        for (const Order &order : orders) {
+            QList<OrderLine> lines;
+            for (const OrderLine &line : order.getMeals()) {
+                lines.append(line);
+            }
+            built.append(std::move(lines));
+        }
+        sink = built.size();
+    }), orders.size());
+    print("build orders with inline OrderLines (after)", measure([&]() {
+        QList<Order> built;
+        built.reserve(orders.size());
+        for (const Order &order : orders) {
+            OrderLines lines;
+            for (const OrderLine &line : order.getMeals()) {
+                lines.append(line);
+            }
+            built.append(Order(order.getId(), order.getUserId(), order.getDate(), std::move(lines)));
+        }
+        sink = built.size();
+    }), orders.size());
+    print("scan lines in QList storage (before)", measure([&]() {
+        qint64 quantities = 0;
+        for (const QList<OrderLine> &lines : listLines) {
+            for (const OrderLine &line : lines) {
+                quantities += line.second;
+            }
+        }
+        sink = quantities;
+    }), orders.size());
+    print("scan lines inline in Order (after)", measure([&]() {
+        qint64 quantities = 0;
+        for (const Order &order : orders) {
+            for (const OrderLine &line : order.getMeals()) {
+                quantities += line.second;
+            }
+        }
+        sink = quantities;
+    }), orders.size());
+}
+
+// Отчеты: ядра агрегации по колонкам заказов против обхода QList<Order> с QMap
+void benchReports(qsizetype orderCount, int threadCount)
+{
+    const QList<Meal> meals = generateMeals();
+    const QList<Order> orders = generateOrders(orderCount, meals);
+    const QList<User> users;
+    std::printf("reports: %lld orders, kernels: %s\n", static_cast<long long>(orders.size()),
+                AggregationKernels::isaName(AggregationKernels::activeIsa()));
+
+    OrderColumns columns;
+    print("build columns", measure([&]() { columns = OrderColumns::fromOrders(orders); }), orders.size());
+
+    // Прежние отчеты: обход заказов с QMap по дате и по блюду
+    print("revenue by date over orders, QMap (before)", measure([&]() {
+        QMap<QDate, qint64> revenueByDate;
+        for (const Order &order : orders) {
+            revenueByDate[order.getDate()] += order.getTotalPrice().kopecks();
+        }
+        sink = revenueByDate.size();
+    }), orders.size());
+    print("revenue report over columns (after)", measure([&]() {
+        RevenueReportStrategy strategy;
+        sink = strategy.generateReport(columns, meals, users).size();
+    }), orders.size());
+    print("popular dishes over orders, QMap (before)", measure([&]() {
+        QMap<int, qint64> quantities;
+        for (const Order &order : orders) {
+            for (const OrderLine &line : order.getMeals()) {
+                quantities[line.first] += line.second;
+            }
+        }
+        sink = quantities.size();
+    }), orders.size());
+    print("popular dishes report over columns (after)", measure([&]() {
+        PopularDishesReportStrategy strategy;
+        sink = strategy.generateReport(columns, meals, users).size();
+    }), orders.size());
+    print("orders by date report over columns (after)", measure([&]() {
+        OrdersByDateReportStrategy strategy;
+        sink = strategy.generateReport(columns, meals, users).size();
+    }), orders.size());
+
+    // Каждый поток строит отчет о выручке по всем заказам; колонки общие, только чтение
+    const Measurement parallel = measure([&]() {
+        std::vector<std::unique_ptr<QThread>> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back(QThread::create([&]() {
+                RevenueReportStrategy strategy;
+                sink = strategy.generateReport(columns, meals, users).size();
+            }));
+        }
+        for (auto &thread : threads) {
+            thread->start();
+        }
+        for (auto &thread : threads) {
+            thread->wait();
+        }
+    });
+    const double seconds = parallel.nanoseconds / 1e9;
+    std::printf("  revenue report on %d threads: %.1f ms, %.1f M orders/s per thread, %.1f M orders/s total\n",
+                threadCount, parallel.nanoseconds / 1e6,
+                double(orders.size()) / seconds / 1e6,
+                double(orders.size()) * threadCount / seconds / 1e6);
+}
+
+// Прежний способ построения сводки месяца: узлы QHash и QMap на каждый заказ
+OrderPartitionSummary summaryBefore(int month, const QList<Order> &orders)
+{
+    OrderPartitionSummary summary;
+    summary.month = month;
+    summary.orderCount = orders.size();
+    for (const Order &order : orders) {
+        summary.revenueKopecks += order.getTotalPrice().kopecks();
+        summary.maxOrderId = qMax(summary.maxOrderId, order.getId());
+        for (const OrderLine &line : order.getMeals()) {
+            summary.mealQuantities[line.first] += line.second;
+        }
+        summary.userIds.append(order.getUserId());
+        const qint32 day = order.getDate().isValid() ? qint32(order.getDate().toJulianDay()) : 0;
+        summary.dailyCounts[day] += 1;
+        summary.dailyRevenue[day] += order.getTotalPrice().kopecks();
+    }
+    std::sort(summary.userIds.begin(), summary.userIds.end());
+    summary.userIds.erase(std::unique(summary.userIds.begin(), summary.userIds.end()), summary.userIds.end());
+    return summary;
+}
+
+QHash<int, QList<Order>> ordersByMonth(const QList<Order> &orders)
+{
+    QHash<int, QList<Order>> byMonth;
+    for (const Order &order : orders) {
+        byMonth[OrderPartitionStore::monthKey(order.getDate())].append(order);
+    }
+    return byMonth;
+}
+
+// Сводки месяцев, как при сохранении: на арене против прежнего способа
+void benchSummary(qsizetype orderCount)
+{
+    const QList<Meal> meals = generateMeals();
+    const QList<Order> orders = generateOrders(orderCount, meals);
+    const QHash<int, QList<Order>> byMonth = ordersByMonth(orders);
+    std::printf("summary: %lld orders in %lld months\n", static_cast<long long>(orders.size()),
+                static_cast<long long>(byMonth.size()));
+
+    QList<OrderPartitionSummary> before;
+    QList<OrderPartitionSummary> after;
+    print("month summaries, QMap/QHash per order (before)", measure([&]() {
+        for (auto it = byMonth.cbegin(); it != byMonth.cend(); ++it) {
+            before.append(summaryBefore(it.key(), it.value()));
+        }
+    }), orders.size());
+    print("month summaries on ScratchArena (after)", measure([&]() {
+        for (auto it = byMonth.cbegin(); it != byMonth.cend(); ++it) {
+            after.append(OrderPartitionSummary::fromOrders(it.key(), it.value()));
+        }
+    }), orders.size());
+
+    for (qsizetype i = 0; i < before.size(); ++i) {
+        if (before[i].toJson() != after[i].toJson()) {
+            std::fprintf(stderr, "summary mismatch for month %d\n", before[i].month);
+        }
+    }
+}
+
+// Файл данных старого формата: все заказы в основном файле (раскладываются по месяцам при загрузке)
+bool writeLegacyData(const QString &path, const QList<Meal> &meals, const QList<Order> &orders)
+{
+    QJsonArray usersArray;
+    usersArray.append(QJsonDocument::fromJson(
+        User(1, "admin", User::hashPassword("admin"), UserType::Admin).toJson().toUtf8()).object());
+    for (int id = 2; id <= UserCount + 1; ++id) {
+        const User user(id, QString("student%1").arg(id), User::hashPassword("1"), UserType::Student,
+                        Money::fromKopecks(1000000));
+        usersArray.append(QJsonDocument::fromJson(user.toJson().toUtf8()).object());
+    }
+    QJsonArray mealsArray;
+    for (const Meal &meal : meals) {
+        mealsArray.append(QJsonDocument::fromJson(meal.toJson().toUtf8()).object());
+    }
+    QJsonArray ordersArray;
+    for (const Order &order : orders) {
+        ordersArray.append(order.toJsonObject());
+    }
+    QJsonObject root;
+    root["users"] = usersArray;
+    root["meals"] = mealsArray;
+    root["orders"] = ordersArray;
+    root["nextOrderId"] = int(orders.size()) + 1;
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) > 0;
+}
+
+// Загрузка заказов старого формата (ключи месяцев на арене) и первое сохранение
+void benchLoad(qsizetype orderCount)
+{
+    const QList<Meal> meals = generateMeals();
+    const QList<Order> orders = generateOrders(orderCount, meals);
+    std::printf("load: %lld orders\n", static_cast<long long>(orders.size()));
+
+    print("legacy month keys, QSet insert per order (before)", measure([&]() {
+        QSet<int> loaded;
+        QSet<int> dirty;
+        for (const Order &order : orders) {
+            const int month = OrderPartitionStore::monthKey(order.getDate());
+            loaded.insert(month);
+            dirty.insert(month);
+        }
+        sink = loaded.size() + dirty.size();
+    }), orders.size());
+    print("legacy month keys on ScratchArena (after)", measure([&]() {
+        ScratchArena arena;
+        auto months = arena.vector<int>();
+        months.reserve(orders.size());
+        for (const Order &order : orders) {
+            months.push_back(OrderPartitionStore::monthKey(order.getDate()));
+        }
+        std::sort(months.begin(), months.end());
+        months.erase(std::unique(months.begin(), months.end()), months.end());
+        QSet<int> loaded;
+        QSet<int> dirty;
+        for (int month : months) {
+            loaded.insert(month);
+            dirty.insert(month);
+        }
+        sink = loaded.size() + dirty.size();
+    }), orders.size());
+
+    QTemporaryDir dataDir;
+    if (!dataDir.isValid() || !writeLegacyData(QDir(dataDir.path()).filePath("cafeteria_data.json"), meals, orders)) {
+        std::fprintf(stderr, "cannot write the data file\n");
+        return;
+    }
+    DataManager::setDataDirectory(dataDir.path());
+    DataManager *dm = nullptr;
+    print("DataManager load", measure([&]() { dm = &DataManager::getInstance(); }), orders.size());
+    print("first save: partitions, summaries, snapshot", measure([&]() { dm->saveData(); }), orders.size());
+}
+
+// Заказы от нескольких киосков через сервис (групповая фиксация) против
+// прямых вызовов placeOrder по одному в одном процессе (fsync на каждый заказ)
+void benchService(qsizetype orderCount, int clientCount)
+{
+    constexpr qint64 PriceKopecks = 5000;
+    const qsizetype perClient = qMax<qsizetype>(1, orderCount / clientCount);
+    const qsizetype directCount = qMin<qsizetype>(perClient, 2000);
+
+    QTemporaryDir dataDir;
+    if (!dataDir.isValid()) {
+        std::fprintf(stderr, "cannot create a temporary data directory\n");
+        return;
+    }
+    DataManager::setDataDirectory(dataDir.path());
+    DataManager &dm = DataManager::getInstance();
+    const int mealId = dm.getNextMealId();
+    dm.addMeal(Meal(mealId, "Каша", Money::fromKopecks(PriceKopecks), 1));
+    QList<int> students;
+    for (int c = 0; c <= clientCount; ++c) {
+        const int userId = dm.getNextUserId();
+        dm.addUser(User(userId, QString("kiosk%1").arg(c), User::hashPassword("1"), UserType::Student,
+                        Money::fromKopecks(PriceKopecks * qMax(perClient, directCount))));
+        students.append(userId);
+    }
+    std::printf("service: %d clients, %lld orders each\n", clientCount, static_cast<long long>(perClient));
+
+    const Measurement direct = measure([&]() {
+        for (qsizetype i = 0; i < directCount; ++i) {
+            dm.placeOrder(students.last(), { qMakePair(mealId, 1) });
+        }
+    });
+    print("direct placeOrder, one client (before)", direct, directCount);
+
+    OrderService service;
+    const QString serverName = QString("canteen-bench-%1").arg(QCoreApplication::applicationPid());
+    if (!service.listen(serverName)) {
+        std::fprintf(stderr, "cannot listen on %s: %s\n", qPrintable(serverName), qPrintable(service.errorString()));
+        return;
+    }
+
+    std::atomic<qsizetype> failed{0};
+    std::vector<std::unique_ptr<QThread>> threads;
+    QEventLoop loop;
+    int running = clientCount;
+    for (int c = 0; c < clientCount; ++c) {
+        const int userId = students[c];
+        threads.emplace_back(QThread::create([&failed, serverName, perClient, userId, mealId]() {
+            OrderServiceClient client;
+            if (!client.connectToServer(serverName)) {
+                failed += perClient;
+                return;
+            }
+            for (qsizetype i = 0; i < perClient; ++i) {
+                if (!client.placeOrder(userId, { qMakePair(mealId, 1) })) {
+                    ++failed;
+                }
+            }
+        }));
+        QObject::connect(threads.back().get(), &QThread::finished, &loop, [&running, &loop]() {
+            if (--running == 0) {
+                loop.quit();
+            }
+        });
+    }
+
+    // Сервис обрабатывает запросы в цикле событий главного потока
+    const Measurement served = measure([&]() {
+        for (auto &thread : threads) {
+            thread->start();
+        }
+        loop.exec();
+    });
+    for (auto &thread : threads) {
+        thread->wait();
+    }
+    print("order service, group commit (after)", served, perClient * clientCount);
+    std::printf("  direct: %.0f orders/s, service: %.0f orders/s, failed: %lld\n",
+                double(directCount) / (direct.nanoseconds / 1e9),
+                double(perClient * clientCount) / (served.nanoseconds / 1e9),
+                static_cast<long long>(failed.load()));
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Замеры времени и выделений памяти на сгенерированных заказах");
+    parser.addHelpOption();
+    parser.addPositionalArgument("case", "lines | reports | summary | load | service");
+    parser.addOption(QCommandLineOption("orders", "Число заказов", "N", "1000000"));
+    parser.addOption(QCommandLineOption("threads", "Число потоков для отчетов", "T",
+                                        QString::number(QThread::idealThreadCount())));
+    parser.addOption(QCommandLineOption("clients", "Число киосков для сервиса заказов", "C", "8"));
+    parser.process(app);
+
+    const QStringList cases = parser.positionalArguments();
+    const qsizetype orderCount = parser.value("orders").toLongLong();
+    if (cases.size() != 1 || orderCount <= 0) {
+        parser.showHelp(1);
+    }
+
+    const QString name = cases.first();
+    if (name == "lines") {
+        benchLines(orderCount);
+    } else if (name == "reports") {
+        benchReports(orderCount, qMax(1, parser.value("threads").toInt()));
+    } else if (name == "summary") {
+        benchSummary(orderCount);
+    } else if (name == "load") {
+        benchLoad(orderCount);
+    } else if (name == "service") {
+        benchService(parser.isSet("orders") ? orderCount : 20000, qMax(1, parser.value("clients").toInt()));
+    } else {
+        std::fprintf(stderr, "unknown case: %s\n", qPrintable(name));
+        return 1;
+    }
+    return 0;
+}
@@ -2,8 +2,8 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 
-Category::Category(int id, const QString &name)
-    : m_id(id), m_name(name)
+Category::Category(int id, QString name)
+    : m_id(id), m_name(std::move(name))
 {
 }
 
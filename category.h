@@ -2,15 +2,16 @@
 #define CATEGORY_H
 
 #include <QString>
+#include <utility>
 
 class Category
 {
 public:
-    Category(int id, const QString &name);
+    Category(int id, QString name);
     
     int getId() const { return m_id; }
-    QString getName() const { return m_name; }
-    void setName(const QString &name) { m_name = name; }
+    const QString &getName() const { return m_name; }
+    void setName(QString name) { m_name = std::move(name); }
     
     QString toJson() const;
     static Category fromJson(const QString &json);
@@ -0,0 +1,78 @@
+#include "checksum.h"
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CHECKSUM_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Checksum {
+
+namespace {
+
+constexpr quint32 Polynomial = 0x82F63B78u; // отраженный 0x1EDC6F41
+
+constexpr std::array<quint32, 256> makeTable()
+{
+    std::array<quint32, 256> table{};
+    for (quint32 i = 0; i < 256; ++i) {
+        quint32 value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = (value & 1) ? (value >> 1) ^ Polynomial : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}
+
+constexpr std::array<quint32, 256> Table = makeTable();
+
+quint32 crc32cScalar(const unsigned char *data, qsizetype size, quint32 crc)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        crc = Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+__attribute__((target("sse4.2")))
+quint32 crc32cSse42(const unsigned char *data, qsizetype size, quint32 crc)
+{
+    quint64 crc64 = crc;
+    qsizetype i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    quint32 crc32 = static_cast<quint32>(crc64);
+    for (; i < size; ++i) {
+        crc32 = _mm_crc32_u8(crc32, data[i]);
+    }
+    return crc32;
+}
+
+bool hasSse42()
+{
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#endif
+
+} // namespace
+
+quint32 crc32c(const char *data, qsizetype size, quint32 crc)
+{
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    crc = ~crc;
+#ifdef CHECKSUM_X86
+    if (hasSse42()) {
+        return ~crc32cSse42(bytes, size, crc);
+    }
+#endif
+    return ~crc32cScalar(bytes, size, crc);
+}
+
+} // namespace Checksum
@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+// CRC32C (полином Кастаньоли) для проверки целостности снимков данных.
+// На x86-64 с SSE4.2 считается аппаратной инструкцией crc32, иначе - по таблице.
+namespace Checksum {
+
+quint32 crc32c(const char *data, qsizetype size, quint32 crc = 0);
+inline quint32 crc32c(const QByteArray &data) { return crc32c(data.constData(), data.size()); }
+
+} // namespace Checksum
+
+#endif // CHECKSUM_H
@@ -0,0 +1,107 @@
+#ifndef COMPOSITION_H
+#define COMPOSITION_H
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+// Составные компараторы и фильтры, собираемые на этапе компиляции:
+//
+//   auto cmp = compose::by<&Meal::getCategoryId>().then<&Meal::getPrice>(compose::desc);
+//   auto filter = compose::where<&Meal::getCategoryId>(isBreakfast)
+//              && compose::where<&Meal::getPrice>(isCheap);
+//
+// Каждый ключ - отдельный тип, поэтому сравнение разворачивается в цепочку
+// встроенных вызовов геттеров без виртуальных вызовов и std::function.
+namespace compose {
+
+struct Ascending {};
+struct Descending {};
+
+inline constexpr Ascending asc{};
+inline constexpr Descending desc{};
+
+template <auto Getter, typename Direction>
+struct Key
+{
+    template <typename T>
+    static int compare(const T &a, const T &b)
+    {
+        const auto &left = std::invoke(Getter, a);
+        const auto &right = std::invoke(Getter, b);
+        constexpr int sign = std::is_same_v<Direction, Descending> ? -1 : 1;
+        if (left < right) {
+            return -sign;
+        }
+        if (right < left) {
+            return sign;
+        }
+        return 0;
+    }
+};
+
+template <typename... Keys>
+struct Comparator
+{
+    template <auto Getter>
+    constexpr Comparator<Keys..., Key<Getter, Ascending>> then(Ascending = asc) const { return {}; }
+
+    template <auto Getter>
+    constexpr Comparator<Keys..., Key<Getter, Descending>> then(Descending) const { return {}; }
+
+    // <0, 0, >0 как у strcmp; следующий ключ проверяется только при равенстве предыдущих
+    template <typename T>
+    int compare(const T &a, const T &b) const
+    {
+        int result = 0;
+        (((result = Keys::compare(a, b)) != 0) || ...);
+        return result;
+    }
+
+    template <typename T>
+    bool operator()(const T &a, const T &b) const
+    {
+        return compare(a, b) < 0;
+    }
+};
+
+template <auto Getter>
+constexpr Comparator<Key<Getter, Ascending>> by(Ascending = asc) { return {}; }
+
+template <auto Getter>
+constexpr Comparator<Key<Getter, Descending>> by(Descending) { return {}; }
+
+template <typename Predicate>
+struct Filter
+{
+    Predicate predicate;
+
+    template <typename T>
+    bool operator()(const T &value) const
+    {
+        return predicate(value);
+    }
+};
+
+template <typename A, typename B>
+constexpr auto operator&&(Filter<A> a, Filter<B> b)
+{
+    auto both = [a = std::move(a), b = std::move(b)](const auto &value) {
+        return a(value) && b(value);
+    };
+    return Filter<decltype(both)>{std::move(both)};
+}
+
+// Фильтр по полю: предикат получает значение геттера
+template <auto Getter, typename Predicate>
+constexpr auto where(Predicate predicate)
+{
+    auto field = [predicate = std::move(predicate)](const auto &value) {
+        return predicate(std::invoke(Getter, value));
+    };
+    return Filter<decltype(field)>{std::move(field)};
+}
+
+} // namespace compose
+
+#endif // COMPOSITION_H
@@ -1,4 +1,9 @@
 #include "datamanager.h"
+#include "filesync.h"
+#include "ordersegment.h"
+#include "perfstats.h"
+#include "stringpool.h"
+#include "scratcharena.h"
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -7,6 +12,93 @@
 #include <QFileInfo>
 #include <QStandardPaths>
 #include <QCoreApplication>
+#include <QDebug>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QLockFile>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+// Месяцы догружаются в произвольном порядке, поэтому выборки упорядочиваются явно
+void sortOrdersById(QList<Order> &orders)
+{
+    std::sort(orders.begin(), orders.end(), [](const Order &a, const Order &b) {
+        return a.getId() < b.getId();
+    });
+}
+
+}
+
+namespace {
+
+QString configuredDataDirectory;
+bool configuredReadOnly = false;
+std::unique_ptr<QLockFile> writerLock;
+
+}
+
+void DataManager::setDataDirectory(const QString &directory)
+{
+    configuredDataDirectory = directory;
+}
+
+void DataManager::setReadOnly(bool readOnly)
+{
+    configuredReadOnly = readOnly;
+}
+
+QString DataManager::resolveDataDirectory()
+{
+    QString directory = configuredDataDirectory;
+    if (directory.isEmpty()) {
+        directory = qEnvironmentVariable("CANTEEN_DATA_DIR");
+    }
+    if (directory.isEmpty()) {
+        // Переносная установка: файл данных рядом с программой
+        const QDir appDir(QCoreApplication::applicationDirPath());
+        directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        if (QFileInfo::exists(appDir.absoluteFilePath("cafeteria_data.json"))) {
+            directory = appDir.absolutePath();
+        } else if (!QFileInfo::exists(QDir(directory).absoluteFilePath("cafeteria_data.json"))) {
+            // Прежние версии хранили данные в каталоге с CMakeLists.txt выше каталога программы.
+            // Если данные лежат там, берем их, а не начинаем с пустого файла
+            QDir legacy = appDir;
+            while (!QFileInfo::exists(legacy.absoluteFilePath("CMakeLists.txt")) && !legacy.isRoot() && legacy.cdUp()) {
+            }
+            if (QFileInfo::exists(legacy.absoluteFilePath("CMakeLists.txt"))
+                && QFileInfo::exists(legacy.absoluteFilePath("cafeteria_data.json"))) {
+                qWarning() << "Data: using data found in the old location" << legacy.absolutePath()
+                           << "- pass --data-dir or set CANTEEN_DATA_DIR to keep using it";
+                directory = legacy.absolutePath();
+            }
+        }
+    }
+    QDir().mkpath(directory);
+    return directory;
+}
+
+bool DataManager::lockForWriting()
+{
+    if (writerLock && writerLock->isLocked()) {
+        return true;
+    }
+    writerLock = std::make_unique<QLockFile>(QDir(resolveDataDirectory()).absoluteFilePath("cafeteria_data.json.lock"));
+    // Блокировку упавшего процесса QLockFile распознает по PID и снимает сам
+    writerLock->setStaleLockTime(0);
+    if (!writerLock->tryLock(0)) {
+        qint64 pid = 0;
+        QString hostname;
+        QString application;
+        writerLock->getLockInfo(&pid, &hostname, &application);
+        qWarning() << "Data: data directory is locked for writing by" << application << "pid" << pid;
+        return false;
+    }
+    return true;
+}
 
 DataManager& DataManager::getInstance()
 {
@@ -15,66 +107,90 @@ DataManager& DataManager::getInstance()
 }
 
 DataManager::DataManager()
-    : m_nextUserId(1)
+    : m_journalCommitter([this](const QByteArray &records) {
+          QMutexLocker fileLocker(&m_fileMutex);
+          return appendJournal(records);
+      })
+    , m_nextUserId(1)
     , m_nextMealId(1)
     , m_nextOrderId(1)
     , m_nextCategoryId(1)
+    , m_mealsVersion(1)
+    , m_readOnly(configuredReadOnly)
+    , m_peakRssAfterLoad(0)
+    , m_peakRssLastSave(0)
 {
-
-    QDir dir(QCoreApplication::applicationDirPath());
-    
-    QFileInfo cmakeFile(dir, "CMakeLists.txt");
-    while (!cmakeFile.exists() && dir.cdUp() && !dir.isRoot()) {
-        cmakeFile = QFileInfo(dir, "CMakeLists.txt");
-    }
+    const QDir dir(resolveDataDirectory());
+    qInfo() << "Data: using directory" << dir.absolutePath();
     
     m_dataFile = dir.absoluteFilePath("cafeteria_data.json");
-    
-    m_categories.append(Category(1, "Завтрак"));
-    m_categories.append(Category(2, "Обед"));
-    m_categories.append(Category(3, "Перекус"));
-    m_nextCategoryId = 4;
+    m_journalFile = m_dataFile + ".journal";
+    m_snapshots.setPath(m_dataFile);
+    m_partitions.setDirectory(dir.absoluteFilePath("orders"));
     
     loadData();
 }
 
 void DataManager::loadData()
 {
-    QFile file(m_dataFile);
-    if (!file.open(QIODevice::ReadOnly)) {
-        // При создании нового файла пароль будет захэширован в конструкторе User
-        User admin(1, "admin", "admin", UserType::Admin, 0.0);
+    PERF_SCOPE("DataManager::loadData");
+    QWriteLocker locker(&m_lock);
+    // Пик считается заново при каждой загрузке, в том числе при перезагрузке киоска
+    MemoryUsage::PeakRssScope peak;
+    loadDataLocked();
+    m_peakRssAfterLoad = peak.peak();
+    // Строки прежних данных больше никому не нужны
+    StringPool::global().prune();
+}
+
+void DataManager::loadDataLocked()
+{
+    QElapsedTimer recoveryTimer;
+    recoveryTimer.start();
+    
+    // Повторная загрузка (клиентский режим) начинается с чистого состояния: иначе
+    // replayJournal пропустил бы записи с id меньше m_nextOrderId, оставшегося от прошлой загрузки
+    resetLocked();
+    
+    if (!m_snapshots.hasAnyGeneration()) {
+        User admin(1, "admin", User::hashPassword("admin"), UserType::Admin);
         m_users.append(admin);
         m_nextUserId = 2;
-        saveData();  // Сохраняем с захэшированным паролем
+        // Клиент без файла данных ничего не создает: файлы принадлежат сервису
+        if (!m_readOnly) {
+            saveDataLocked();
+        }
         return;
     }
     
-    QByteArray data = file.readAll();
-    file.close();
+    QJsonObject root;
+    int generation = 0;
+    if (!m_snapshots.load(&root, &generation)) {
+        // Поврежденные файлы не перезаписываем: их еще можно восстановить вручную
+        qCritical() << "Data: no valid snapshot of" << m_dataFile << "- starting read-only";
+        m_readOnly = true;
+    } else if (generation > 0) {
+        qWarning() << "Data: recovered from previous generation" << m_snapshots.generationPath(generation);
+        if (!m_readOnly) {
+            m_snapshots.quarantineNewerThan(generation);
+        }
+    }
     
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    QJsonObject root = doc.object();
+    // Ключи JSON - QLatin1String: поиск по ним не создает временных QString.
+    // Повторяющиеся строки (логины, названия, пути к картинкам) берутся из общего пула.
+    StringPool &strings = StringPool::global();
     
-    m_users.clear();
-    QJsonArray usersArray = root["users"].toArray();
-    bool needsMigration = false;
+    const QJsonArray usersArray = root.value(QLatin1String("users")).toArray();
+    m_users.reserve(usersArray.size());
     for (const auto &value : usersArray) {
-        QJsonObject userObj = value.toObject();
-        QString password = userObj["password"].toString();
-        
-        // Миграция: если пароль не хэширован, хэшируем его
-        if (!User::isHashed(password)) {
-            password = User::hashPassword(password);
-            needsMigration = true;
-        }
-        
+        const QJsonObject userObj = value.toObject();
+        // Открытые пароли старых файлов хэширует фоновая миграция (startPasswordMigration)
         User user(
-            userObj["id"].toInt(),
-            userObj["username"].toString(),
-            password,
-            static_cast<UserType>(userObj["type"].toInt()),
-            userObj["balance"].toDouble()
+            userObj[QLatin1String("id")].toInt(),
+            strings.intern(userObj[QLatin1String("username")].toString()),
+            userObj[QLatin1String("password")].toString(),
+            static_cast<UserType>(userObj[QLatin1String("type")].toInt()),
+            Money::fromJson(userObj, "balanceKopecks", "balance")
         );
         m_users.append(user);
         if (user.getId() >= m_nextUserId) {
@@ -82,18 +198,14 @@ void DataManager::loadData()
         }
     }
     
-    // Сохраняем данные, если была миграция паролей
-    if (needsMigration) {
-        saveData();
-    }
-    
     // Загрузка категорий
-    if (root.contains("categories")) {
+    if (root.contains(QLatin1String("categories"))) {
         m_categories.clear();
-        QJsonArray categoriesArray = root["categories"].toArray();
+        const QJsonArray categoriesArray = root.value(QLatin1String("categories")).toArray();
+        m_categories.reserve(categoriesArray.size());
         for (const auto &value : categoriesArray) {
-            QJsonObject catObj = value.toObject();
-            Category cat(catObj["id"].toInt(), catObj["name"].toString());
+            const QJsonObject catObj = value.toObject();
+            Category cat(catObj[QLatin1String("id")].toInt(), strings.intern(catObj[QLatin1String("name")].toString()));
             m_categories.append(cat);
             if (cat.getId() >= m_nextCategoryId) {
                 m_nextCategoryId = cat.getId() + 1;
@@ -102,59 +214,125 @@ void DataManager::loadData()
     }
     
     // Загрузка блюд
-    m_meals.clear();
-    QJsonArray mealsArray = root["meals"].toArray();
+    const QJsonArray mealsArray = root.value(QLatin1String("meals")).toArray();
+    m_meals.reserve(mealsArray.size());
     for (const auto &value : mealsArray) {
-        QJsonObject mealObj = value.toObject();
+        const QJsonObject mealObj = value.toObject();
         Meal meal(
-            mealObj["id"].toInt(),
-            mealObj["name"].toString(),
-            mealObj["price"].toDouble(),
-            mealObj["categoryId"].toInt(),
-            mealObj.contains("imagePath") ? mealObj["imagePath"].toString() : QString()
+            mealObj[QLatin1String("id")].toInt(),
+            strings.intern(mealObj[QLatin1String("name")].toString()),
+            Money::fromJson(mealObj, "priceKopecks", "price"),
+            mealObj[QLatin1String("categoryId")].toInt(),
+            strings.intern(mealObj[QLatin1String("imagePath")].toString())
         );
         m_meals.append(meal);
         if (meal.getId() >= m_nextMealId) {
             m_nextMealId = meal.getId() + 1;
         }
     }
+    ++m_mealsVersion;
     
-    // Загрузка заказов
-    m_orders.clear();
-    QJsonArray ordersArray = root["orders"].toArray();
-    for (const auto &value : ordersArray) {
-        QJsonObject orderObj = value.toObject();
-        QDate date = QDate::fromString(orderObj["date"].toString(), Qt::ISODate);
-        
-        QList<QPair<int, int>> meals;
-        QJsonArray mealsArray = orderObj["meals"].toArray();
-        for (const auto &mealValue : mealsArray) {
-            QJsonObject mealObj = mealValue.toObject();
-            meals.append(qMakePair(mealObj["mealId"].toInt(), mealObj["quantity"].toInt()));
-        }
-        
-        Order order(
-            orderObj["id"].toInt(),
-            orderObj["userId"].toInt(),
-            date,
-            meals
-        );
-        order.setTotalPrice(orderObj["totalPrice"].toDouble());
-        m_orders.append(order);
-        if (order.getId() >= m_nextOrderId) {
-            m_nextOrderId = order.getId() + 1;
-        }
+    // Загрузка заказов: сводки по всем месяцам и заказы текущего месяца
+    m_nextOrderId = qMax(m_nextOrderId, root["nextOrderId"].toInt());
+    int committedNextOrderId = root["nextOrderId"].toInt();
+    if (root.contains("archive")) {
+        const QJsonObject archive = root["archive"].toObject();
+        m_archivePolicy.horizonMonths = archive["horizonMonths"].toInt(m_archivePolicy.horizonMonths);
+        m_archivePolicy.automatic = archive["automatic"].toBool();
+    }
+    if (!m_partitions.loadIndex()) {
+        qWarning() << "Orders: some months could not be read, the partition index will not be overwritten";
+    }
+    for (const OrderPartitionSummary &summary : m_partitions.summaries()) {
+        m_nextOrderId = qMax(m_nextOrderId, summary.maxOrderId + 1);
+    }
+    
+    // Старый формат: все заказы в основном файле. Раскладываются по месяцам при следующем сохранении.
+    // Ключи месяцев копятся на арене и попадают в множества по одному разу
+    const QJsonArray legacyOrders = root["orders"].toArray();
+    ScratchArena arena;
+    auto legacyMonths = arena.vector<int>();
+    legacyMonths.reserve(legacyOrders.size());
+    m_orders.reserve(legacyOrders.size());
+    for (const auto &value : legacyOrders) {
+        Order order = Order::fromJsonObject(value.toObject());
+        legacyMonths.push_back(OrderPartitionStore::monthKey(order.getDate()));
+        m_nextOrderId = qMax(m_nextOrderId, order.getId() + 1);
+        committedNextOrderId = qMax(committedNextOrderId, order.getId() + 1);
+        m_orders.append(std::move(order));
     }
+    std::sort(legacyMonths.begin(), legacyMonths.end());
+    legacyMonths.erase(std::unique(legacyMonths.begin(), legacyMonths.end()), legacyMonths.end());
+    for (int month : legacyMonths) {
+        m_loadedMonths.insert(month);
+        m_dirtyMonths.insert(month);
+    }
+    m_orderColumns = OrderColumns::fromOrders(m_orders);
+    ensureMonthLoadedLocked(OrderPartitionStore::monthKey(QDate::currentDate()));
+    
+    // Заказы, оформленные после последнего полного сохранения
+    replayJournal(committedNextOrderId);
     
     if (m_users.isEmpty()) {
-        User admin(1, "admin", "admin", UserType::Admin, 0.0);
+        User admin(1, "admin", User::hashPassword("admin"), UserType::Admin);
         m_users.append(admin);
         m_nextUserId = 2;
     }
+    
+    qInfo() << "Data: loaded snapshot generation" << generation << "and journal in"
+            << recoveryTimer.elapsed() << "ms";
+}
+
+void DataManager::resetLocked()
+{
+    m_users.clear();
+    m_meals.clear();
+    m_orders.clear();
+    m_orderColumns.clear();
+    m_loadedMonths.clear();
+    m_dirtyMonths.clear();
+    m_archivePolicy = ArchivePolicy();
+    
+    m_categories.clear();
+    m_categories.append(Category(1, "Завтрак"));
+    m_categories.append(Category(2, "Обед"));
+    m_categories.append(Category(3, "Перекус"));
+    
+    m_nextUserId = 1;
+    m_nextMealId = 1;
+    m_nextOrderId = 1;
+    m_nextCategoryId = 4;
+    // m_mealsVersion не сбрасывается: окна сравнивают его с запомненным значением
+    ++m_mealsVersion;
 }
 
 void DataManager::saveData()
 {
+    PERF_SCOPE("DataManager::saveData");
+    // Исключительная блокировка: сохранение обновляет сводки месяцев
+    QWriteLocker locker(&m_lock);
+    MemoryUsage::PeakRssScope peak;
+    saveDataLocked();
+    // Значение последнего сохранения, а не максимум: иначе одно большое сохранение
+    // навсегда заслонило бы все следующие
+    m_peakRssLastSave = peak.peak();
+    // Сохранение периодическое - заодно освобождаются названия удаленных и переименованных блюд
+    StringPool::global().prune();
+}
+
+bool DataManager::hasJournalRecords()
+{
+    QMutexLocker fileLocker(&m_fileMutex);
+    return QFileInfo(m_journalFile).size() > 0;
+}
+
+void DataManager::saveDataLocked()
+{
+    if (m_readOnly) {
+        return;
+    }
+    
+    QMutexLocker fileLocker(&m_fileMutex);
     QJsonObject root;
     
     QJsonArray usersArray;
@@ -178,32 +356,231 @@ void DataManager::saveData()
     }
     root["meals"] = mealsArray;
     
-    QJsonArray ordersArray;
-    for (const Order &order : m_orders) {
-        QJsonDocument doc = QJsonDocument::fromJson(order.toJson().toUtf8());
-        ordersArray.append(doc.object());
+    // Сами заказы лежат в помесячных файлах; переписываются только измененные месяцы.
+    // Пока они не записаны, старый снимок (возможно, еще со всеми заказами) не трогаем.
+    root["nextOrderId"] = m_nextOrderId;
+    QJsonObject archive;
+    archive["horizonMonths"] = m_archivePolicy.horizonMonths;
+    archive["automatic"] = m_archivePolicy.automatic;
+    root["archive"] = archive;
+    if (!savePartitionsLocked()) {
+        qWarning() << "Data: order partitions were not saved, keeping the previous snapshot and journal";
+        return;
     }
-    root["orders"] = ordersArray;
     
     QJsonDocument doc(root);
-    QFile file(m_dataFile);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    QString error;
+    if (m_snapshots.write(doc.toJson(), &error)) {
+        // Все транзакции журнала вошли в снимок
+        truncateJournal();
+    } else {
+        qWarning() << "Data: failed to save" << m_dataFile << ":" << error;
     }
 }
 
-User* DataManager::findUser(const QString &username, const QString &password)
+bool DataManager::appendJournal(const QByteArray &records)
 {
-    for (auto &user : m_users) {
+    if (m_readOnly) {
+        return false;
+    }
+    
+    QFile journal(m_journalFile);
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    
+    const qint64 start = journal.size();
+    bool ok = journal.write(records) == records.size() && syncToDisk(journal);
+    if (!ok) {
+        // Не оставляем оборванную запись: на ней остановилось бы восстановление
+        // и следующие подтвержденные пакеты были бы потеряны
+        journal.resize(start);
+    }
+    journal.close();
+    return ok;
+}
+
+void DataManager::replayJournal(int committedNextOrderId)
+{
+    QFile journal(m_journalFile);
+    if (!journal.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    // Заказы журнала, уже записанные в файлы месяцев: месяц сохраняется раньше индекса и снимка,
+    // и если индекс не записался, снимок и журнал остаются прежними
+    QSet<int> storedOrderIds;
+    qsizetype scannedOrders = 0;
+    int replayed = 0;
+    while (!journal.atEnd()) {
+        QByteArray line = journal.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        
+        QJsonParseError error;
+        QJsonObject record = QJsonDocument::fromJson(line, &error).object();
+        if (error.error != QJsonParseError::NoError) {
+            // Оборванная запись: сбой во время записи, транзакция не была подтверждена
+            qWarning() << "Journal: ignoring incomplete record in" << m_journalFile;
+            break;
+        }
+        
+        if (record["type"].toString() == "order") {
+            Order order = Order::fromJson(record["order"].toString());
+            // Заказ уже попал в снимок (сбой между сохранением и очисткой журнала)
+            if (order.getId() < committedNextOrderId) {
+                continue;
+            }
+            ensureMonthLoadedLocked(OrderPartitionStore::monthKey(order.getDate()));
+            for (; scannedOrders < m_orders.size(); ++scannedOrders) {
+                if (m_orders[scannedOrders].getId() >= committedNextOrderId) {
+                    storedOrderIds.insert(m_orders[scannedOrders].getId());
+                }
+            }
+            // Баланс из журнала применяется и для записанного заказа: снимок его не содержит
+            if (!storedOrderIds.contains(order.getId())) {
+                appendOrderLocked(order);
+                ++replayed;
+            }
+            m_nextOrderId = qMax(m_nextOrderId, order.getId() + 1);
+            
+            User *user = userByIdLocked(record["userId"].toInt());
+            if (user && record.contains("balanceKopecks")) {
+                user->setBalance(Money::fromJson(record, "balanceKopecks", "balance"));
+            }
+        }
+    }
+    journal.close();
+    
+    if (replayed > 0) {
+        qInfo() << "Journal: restored" << replayed << "orders from" << m_journalFile;
+    }
+}
+
+void DataManager::truncateJournal()
+{
+    Q_ASSERT(!m_readOnly);
+    QFile journal(m_journalFile);
+    if (journal.exists()) {
+        journal.resize(0);
+    }
+}
+
+QFuture<void> DataManager::startPasswordMigration()
+{
+    QMutexLocker migrationLocker(&m_migrationMutex);
+    if (m_passwordMigration.isRunning()) {
+        return m_passwordMigration;
+    }
+    m_passwordMigration = QtConcurrent::run([this]() { migratePasswords(); });
+    return m_passwordMigration;
+}
+
+void DataManager::waitForPasswordMigration()
+{
+    QMutexLocker migrationLocker(&m_migrationMutex);
+    m_passwordMigration.waitForFinished();
+}
+
+PasswordMigrationProgress DataManager::getPasswordMigrationProgress() const
+{
+    PasswordMigrationProgress progress;
+    progress.done = m_migrationDone.load(std::memory_order_relaxed);
+    progress.total = m_migrationTotal.load(std::memory_order_relaxed);
+    return progress;
+}
+
+void DataManager::migratePasswords()
+{
+    struct PendingPassword
+    {
+        int userId;
+        QString plain;
+        QString hash;
+    };
+    
+    QList<PendingPassword> pending;
+    {
+        QReadLocker locker(&m_lock);
+        if (m_readOnly) {
+            return;
+        }
+        for (const User &user : m_users) {
+            if (!User::isHashed(user.getPassword())) {
+                pending.append({ user.getId(), user.getPassword(), QString() });
+            }
+        }
+    }
+    if (pending.isEmpty()) {
+        return;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    m_migrationDone.store(0, std::memory_order_relaxed);
+    m_migrationTotal.store(int(pending.size()), std::memory_order_relaxed);
+    qInfo() << "Users: migrating" << pending.size() << "plaintext passwords";
+    
+    // Хэширование - без блокировки данных, в общем пуле потоков
+    const int total = int(pending.size());
+    const int reportStep = qMax(1, total / 10);
+    QtConcurrent::blockingMap(pending, [this, total, reportStep](PendingPassword &entry) {
+        entry.hash = User::hashPassword(entry.plain);
+        const int done = m_migrationDone.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (done % reportStep == 0) {
+            qInfo() << "Users: hashed" << done << "of" << total << "passwords";
+        }
+    });
+    
+    QWriteLocker locker(&m_lock);
+    if (m_readOnly) {
+        return;
+    }
+    QHash<int, User *> usersById;
+    usersById.reserve(m_users.size());
+    for (User &user : m_users) {
+        usersById.insert(user.getId(), &user);
+    }
+    int migrated = 0;
+    for (const PendingPassword &entry : pending) {
+        User *user = usersById.value(entry.userId);
+        // Пароль мог смениться, пока шло хэширование
+        if (user && user->getPassword() == entry.plain) {
+            user->setPasswordHash(entry.hash);
+            ++migrated;
+        }
+    }
+    if (migrated > 0) {
+        saveDataLocked();
+    }
+    qInfo() << "Users: migrated" << migrated << "passwords in" << timer.elapsed() << "ms";
+}
+
+std::optional<User> DataManager::findUser(const QString &username, const QString &password) const
+{
+    PERF_SCOPE("DataManager::findUser");
+    QReadLocker locker(&m_lock);
+    for (const auto &user : m_users) {
         if (user.getUsername() == username && user.verifyPassword(password)) {
-            return &user;
+            return user;
         }
     }
-    return nullptr;
+    return std::nullopt;
+}
+
+std::optional<User> DataManager::getUserById(int id) const
+{
+    QReadLocker locker(&m_lock);
+    for (const auto &user : m_users) {
+        if (user.getId() == id) {
+            return user;
+        }
+    }
+    return std::nullopt;
 }
 
-User* DataManager::getUserById(int id)
+User* DataManager::userByIdLocked(int id)
 {
     for (auto &user : m_users) {
         if (user.getId() == id) {
@@ -215,22 +592,70 @@ User* DataManager::getUserById(int id)
 
 void DataManager::addUser(const User &user)
 {
+    QWriteLocker locker(&m_lock);
     m_users.append(user);
-    saveData();
+    saveDataLocked();
+}
+
+RosterImportResult DataManager::addStudents(const QList<RosterEntry> &entries)
+{
+    RosterImportResult result;
+    QWriteLocker locker(&m_lock);
+    if (m_readOnly) {
+        result.errors.append("Данные открыты только для чтения");
+        return result;
+    }
+    
+    QSet<QString> usernames;
+    usernames.reserve(m_users.size() + entries.size());
+    for (const User &user : m_users) {
+        usernames.insert(user.getUsername());
+    }
+    
+    m_users.reserve(m_users.size() + entries.size());
+    const int firstId = m_nextUserId;
+    for (const RosterEntry &entry : entries) {
+        if (usernames.contains(entry.username)) {
+            result.duplicates.append(entry.username);
+            continue;
+        }
+        usernames.insert(entry.username);
+        m_users.append(User(firstId + result.added, entry.username, entry.password, UserType::Student, entry.balance));
+        ++result.added;
+    }
+    
+    if (result.added > 0) {
+        m_nextUserId = firstId + result.added;
+        saveDataLocked();
+    }
+    return result;
 }
 
 void DataManager::updateUser(const User &user)
 {
+    QWriteLocker locker(&m_lock);
     for (auto &u : m_users) {
         if (u.getId() == user.getId()) {
             u = user;
-            saveData();
+            saveDataLocked();
             break;
         }
     }
 }
 
-Meal* DataManager::getMealById(int id)
+std::optional<Meal> DataManager::getMealById(int id) const
+{
+    PERF_SCOPE("DataManager::getMealById");
+    QReadLocker locker(&m_lock);
+    for (const auto &meal : m_meals) {
+        if (meal.getId() == id) {
+            return meal;
+        }
+    }
+    return std::nullopt;
+}
+
+Meal* DataManager::mealByIdLocked(int id)
 {
     for (auto &meal : m_meals) {
         if (meal.getId() == id) {
@@ -242,16 +667,20 @@ Meal* DataManager::getMealById(int id)
 
 void DataManager::addMeal(const Meal &meal)
 {
+    QWriteLocker locker(&m_lock);
     m_meals.append(meal);
-    saveData();
+    ++m_mealsVersion;
+    saveDataLocked();
 }
 
 void DataManager::updateMeal(const Meal &meal)
 {
+    QWriteLocker locker(&m_lock);
     for (auto &m : m_meals) {
         if (m.getId() == meal.getId()) {
             m = meal;
-            saveData();
+            ++m_mealsVersion;
+            saveDataLocked();
             break;
         }
     }
@@ -259,10 +688,12 @@ void DataManager::updateMeal(const Meal &meal)
 
 void DataManager::removeMeal(int id)
 {
+    QWriteLocker locker(&m_lock);
     for (int i = 0; i < m_meals.size(); ++i) {
         if (m_meals[i].getId() == id) {
             m_meals.removeAt(i);
-            saveData();
+            ++m_mealsVersion;
+            saveDataLocked();
             break;
         }
     }
@@ -270,70 +701,576 @@ void DataManager::removeMeal(int id)
 
 void DataManager::addOrder(const Order &order)
 {
-    m_orders.append(order);
-    saveData();
+    PERF_SCOPE("DataManager::addOrder");
+    quint64 ticket;
+    {
+        QWriteLocker locker(&m_lock);
+        QJsonObject record;
+        record["type"] = "order";
+        record["order"] = order.toJson();
+        record["userId"] = order.getUserId();
+        ticket = m_journalCommitter.submit(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n', 1);
+        appendOrderLocked(order);
+        m_nextOrderId = qMax(m_nextOrderId, order.getId() + 1);
+    }
+    if (!m_journalCommitter.waitForCommit(ticket)) {
+        qWarning() << "Journal: failed to commit order" << order.getId();
+    }
+}
+
+std::optional<Order> DataManager::placeOrder(int userId, const QList<OrderLine> &cart, QString *errorMessage)
+{
+    PERF_SCOPE("DataManager::placeOrder");
+    const QList<OrderResult> results = placeOrders({ OrderRequest{ userId, cart } });
+    const OrderResult &result = results.first();
+    if (!result.order && errorMessage) {
+        *errorMessage = result.error;
+    }
+    return result.order;
+}
+
+QList<OrderResult> DataManager::placeOrders(const QList<OrderRequest> &requests)
+{
+    PERF_SCOPE("DataManager::placeOrders");
+    PERF_COUNT("DataManager::placeOrders.requests", requests.size());
+    QList<OrderResult> results;
+    results.reserve(requests.size());
+    quint64 ticket;
+    
+    {
+        QWriteLocker locker(&m_lock);
+        // Месяц мог смениться, пока программа работала
+        ensureMonthLoadedLocked(OrderPartitionStore::monthKey(QDate::currentDate()));
+        QHash<int, Money> balances; // балансы с учетом уже принятых заказов пакета
+        QByteArray journalRecords;
+        int recordCount = 0;
+        
+        for (const OrderRequest &request : requests) {
+            OrderResult result;
+            User *user = userByIdLocked(request.userId);
+            if (!user) {
+                result.error = "Пользователь не найден";
+                results.append(result);
+                continue;
+            }
+            
+            Money balance = balances.value(request.userId, user->getBalance());
+            Money total;
+            result.error = priceCartLocked(request.cart, &total);
+            if (result.error.isEmpty() && balance < total) {
+                result.error = QString("Недостаточно средств. Необходимо: %1 руб., у вас: %2 руб.")
+                               .arg(total.toString())
+                               .arg(balance.toString());
+            }
+            if (!result.error.isEmpty()) {
+                result.balance = balance;
+                results.append(result);
+                continue;
+            }
+            
+            Order order(m_nextOrderId++, request.userId, QDate::currentDate(), request.cart);
+            order.setTotalPrice(total);
+            balance -= total;
+            balances[request.userId] = balance;
+            
+            QJsonObject record;
+            record["type"] = "order";
+            record["order"] = order.toJson();
+            record["userId"] = request.userId;
+            record["balanceKopecks"] = balance.kopecks();
+            journalRecords += QJsonDocument(record).toJson(QJsonDocument::Compact);
+            journalRecords += '\n';
+            ++recordCount;
+            
+            result.order = order;
+            result.balance = balance;
+            results.append(result);
+        }
+        
+        if (recordCount == 0) {
+            return results;
+        }
+        
+        // Записи ставятся в очередь под блокировкой, поэтому порядок в журнале
+        // совпадает с порядком номеров заказов. Изменения видны сразу, чтобы
+        // следующие заказы проверялись по новым балансам, но подтверждение
+        // вызывающему уходит только после fsync.
+        ticket = m_journalCommitter.submit(journalRecords, recordCount);
+        for (const OrderResult &result : results) {
+            if (result.order) {
+                appendOrderLocked(*result.order);
+            }
+        }
+        for (auto it = balances.cbegin(); it != balances.cend(); ++it) {
+            userByIdLocked(it.key())->setBalance(it.value());
+        }
+    }
+    
+    // Блокировка данных уже снята: другие потоки оформляют заказы, пока идет fsync,
+    // и их записи уходят тем же или следующим пакетом
+    if (!m_journalCommitter.waitForCommit(ticket)) {
+        QWriteLocker locker(&m_lock);
+        rollbackOrdersLocked(results);
+    }
+    return results;
+}
+
+// Отменяет заказы, записи которых не удалось зафиксировать в журнале
+void DataManager::rollbackOrdersLocked(QList<OrderResult> &results)
+{
+    for (OrderResult &result : results) {
+        if (!result.order) {
+            continue;
+        }
+        
+        const int orderId = result.order->getId();
+        for (int i = 0; i < m_orders.size(); ++i) {
+            if (m_orders[i].getId() == orderId) {
+                m_orders.removeAt(i);
+                break;
+            }
+        }
+        m_dirtyMonths.insert(OrderPartitionStore::monthKey(result.order->getDate()));
+        User *user = userByIdLocked(result.order->getUserId());
+        if (user) {
+            user->addBalance(result.order->getTotalPrice());
+            result.balance = user->getBalance();
+        }
+        result.order.reset();
+        result.error = "Не удалось сохранить заказ";
+    }
+    m_orderColumns = OrderColumns::fromOrders(m_orders);
+    // Снимок мог успеть сохранить отмененные заказы - перезаписываем его
+    saveDataLocked();
+}
+
+QString DataManager::priceCartLocked(const QList<OrderLine> &cart, Money *total)
+{
+    if (cart.isEmpty()) {
+        return "Корзина пуста";
+    }
+    
+    // Цены берем из текущего меню, а не из того, что видел клиент
+    *total = Money();
+    for (const OrderLine &line : cart) {
+        const Meal *meal = mealByIdLocked(line.first);
+        if (!meal) {
+            return "Блюда из корзины больше нет в меню";
+        }
+        if (line.second <= 0) {
+            return "Некорректное количество в корзине";
+        }
+        *total += meal->getPrice() * line.second;
+    }
+    return QString();
+}
+
+bool DataManager::isReadOnly() const
+{
+    QReadLocker locker(&m_lock);
+    return m_readOnly;
+}
+
+QList<Order> DataManager::getOrders()
+{
+    QList<int> months;
+    const QMap<int, OrderPartitionSummary> summaries = getOrderSummaries();
+    for (const OrderPartitionSummary &summary : summaries) {
+        if (!summary.archived) {
+            months.append(summary.month);
+        }
+    }
+    ensureMonthsLoaded(months);
+    QReadLocker locker(&m_lock);
+    QList<Order> result = m_orders;
+    locker.unlock();
+    sortOrdersById(result);
+    return result;
+}
+
+OrderColumns DataManager::getOrderColumns()
+{
+    QList<int> months;
+    const QMap<int, OrderPartitionSummary> summaries = getOrderSummaries();
+    for (const OrderPartitionSummary &summary : summaries) {
+        if (!summary.archived) {
+            months.append(summary.month);
+        }
+    }
+    ensureMonthsLoaded(months);
+    QReadLocker locker(&m_lock);
+    return m_orderColumns;
 }
 
-QList<Order> DataManager::getOrdersByUserId(int userId) const
+QList<Order> DataManager::getOrdersByUserId(int userId)
 {
+    PERF_SCOPE("DataManager::getOrdersByUserId");
+    // Сводки знают, в каких месяцах пользователь делал заказы
+    QList<int> months;
+    const QMap<int, OrderPartitionSummary> summaries = getOrderSummaries();
+    for (const OrderPartitionSummary &summary : summaries) {
+        if (std::binary_search(summary.userIds.cbegin(), summary.userIds.cend(), userId)) {
+            months.append(summary.month);
+        }
+    }
+    ensureMonthsLoaded(months);
+    
+    QReadLocker locker(&m_lock);
     QList<Order> result;
     for (const Order &order : m_orders) {
         if (order.getUserId() == userId) {
             result.append(order);
         }
     }
+    // Архивные месяцы сканируются прямо по отображенной колонке userIds
+    for (int month : months) {
+        if (!m_partitions.isArchived(month)) {
+            continue;
+        }
+        const std::shared_ptr<const OrderSegment> segment = m_partitions.segment(month);
+        if (!segment) {
+            continue;
+        }
+        const qint32 *userIds = segment->columns().userIds;
+        for (qsizetype row = 0; row < segment->size(); ++row) {
+            if (userIds[row] == userId) {
+                result.append(segment->orderAt(row));
+            }
+        }
+    }
+    locker.unlock();
+    sortOrdersById(result);
     return result;
 }
 
-QList<Order> DataManager::getOrdersByDate(const QDate &date) const
+QList<Order> DataManager::getOrdersByDate(const QDate &date)
+{
+    PERF_SCOPE("DataManager::getOrdersByDate");
+    return getOrdersInRange(date, date);
+}
+
+QList<Order> DataManager::getOrdersInRange(const QDate &from, const QDate &to)
 {
+    PERF_SCOPE("DataManager::getOrdersInRange");
+    QList<int> months;
+    const int lastMonth = OrderPartitionStore::monthKey(to);
+    for (int month = OrderPartitionStore::monthKey(from); month <= lastMonth;
+         month = OrderPartitionStore::nextMonth(month)) {
+        months.append(month);
+    }
+    ensureMonthsLoaded(months);
+    
+    QReadLocker locker(&m_lock);
     QList<Order> result;
     for (const Order &order : m_orders) {
-        if (order.getDate() == date) {
+        if (order.getDate() >= from && order.getDate() <= to) {
             result.append(order);
         }
     }
+    const qint32 firstDay = static_cast<qint32>(from.toJulianDay());
+    const qint32 lastDay = static_cast<qint32>(to.toJulianDay());
+    for (int month : months) {
+        if (!m_partitions.isArchived(month)) {
+            continue;
+        }
+        const std::shared_ptr<const OrderSegment> segment = m_partitions.segment(month);
+        if (!segment) {
+            continue;
+        }
+        const qint32 *days = segment->columns().days;
+        for (qsizetype row = 0; row < segment->size(); ++row) {
+            if (days[row] >= firstDay && days[row] <= lastDay) {
+                result.append(segment->orderAt(row));
+            }
+        }
+    }
+    locker.unlock();
+    sortOrdersById(result);
     return result;
 }
 
-Category* DataManager::getCategoryById(int id)
+QMap<int, OrderPartitionSummary> DataManager::getOrderSummaries() const
+{
+    QReadLocker locker(&m_lock);
+    return m_partitions.summaries();
+}
+
+OrderArchive DataManager::getArchive() const
+{
+    QReadLocker locker(&m_lock);
+    return m_partitions.archive();
+}
+
+int DataManager::archiveOrdersBefore(const QDate &horizon, QString *errorMessage)
 {
-    for (auto &cat : m_categories) {
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return -1;
+    };
+    
+    QWriteLocker locker(&m_lock);
+    if (m_readOnly) {
+        return fail("Архивация недоступна в режиме только для чтения");
+    }
+    
+    // Сначала фиксируем все изменения: архивируются только сохраненные месяцы
+    saveDataLocked();
+    
+    const int currentMonth = OrderPartitionStore::monthKey(QDate::currentDate());
+    QList<int> candidates;
+    for (const OrderPartitionSummary &summary : m_partitions.summaries()) {
+        const bool expired = OrderPartitionStore::monthStart(OrderPartitionStore::nextMonth(summary.month)) <= horizon;
+        if (!summary.archived && expired && summary.month < currentMonth) {
+            candidates.append(summary.month);
+        }
+    }
+    
+    int archived = 0;
+    for (int month : candidates) {
+        if (m_dirtyMonths.contains(month)) {
+            return fail("Не удалось сохранить заказы перед архивацией");
+        }
+        QString error;
+        if (!m_partitions.archivePartition(month, &error)) {
+            m_orderColumns = OrderColumns::fromOrders(m_orders);
+            return fail(error);
+        }
+        
+        // Месяц уходит из рабочего набора
+        m_orders.erase(std::remove_if(m_orders.begin(), m_orders.end(), [month](const Order &order) {
+            return OrderPartitionStore::monthKey(order.getDate()) == month;
+        }), m_orders.end());
+        m_loadedMonths.remove(month);
+        ++archived;
+    }
+    
+    if (archived > 0) {
+        m_orderColumns = OrderColumns::fromOrders(m_orders);
+        qInfo() << "Orders: archived" << archived << "months before" << horizon.toString(Qt::ISODate);
+    }
+    return archived;
+}
+
+int DataManager::archiveExpiredOrders(QString *errorMessage)
+{
+    const QDate today = QDate::currentDate();
+    const QDate horizon = QDate(today.year(), today.month(), 1).addMonths(-getArchivePolicy().horizonMonths);
+    return archiveOrdersBefore(horizon, errorMessage);
+}
+
+ArchivePolicy DataManager::getArchivePolicy() const
+{
+    QReadLocker locker(&m_lock);
+    return m_archivePolicy;
+}
+
+void DataManager::setArchivePolicy(const ArchivePolicy &policy)
+{
+    QWriteLocker locker(&m_lock);
+    m_archivePolicy = policy;
+    saveDataLocked();
+}
+
+void DataManager::ensureMonthsLoaded(const QList<int> &months)
+{
+    {
+        QReadLocker locker(&m_lock);
+        bool allLoaded = true;
+        for (int month : months) {
+            if (!isMonthLoadedLocked(month)) {
+                allLoaded = false;
+                break;
+            }
+        }
+        if (allLoaded) {
+            return;
+        }
+    }
+    
+    QWriteLocker locker(&m_lock);
+    for (int month : months) {
+        ensureMonthLoadedLocked(month);
+    }
+}
+
+// Архивные месяцы не загружаются: они читаются на месте из отображенных сегментов
+bool DataManager::isMonthLoadedLocked(int month) const
+{
+    return m_loadedMonths.contains(month) || m_partitions.isArchived(month);
+}
+
+// Вызывается под блокировкой на запись
+void DataManager::ensureMonthLoadedLocked(int month)
+{
+    if (isMonthLoadedLocked(month)) {
+        return;
+    }
+    
+    QList<Order> orders;
+    if (!m_partitions.readPartition(month, &orders)) {
+        // Месяц не отмечается загруженным: иначе сохранение перезаписало бы его файл
+        qWarning() << "Orders: partition" << month << "is damaged and was not loaded";
+        return;
+    }
+    m_loadedMonths.insert(month);
+    for (const Order &order : orders) {
+        m_orders.append(order);
+        m_orderColumns.append(order);
+        // Файл месяца может быть новее индекса и снимка - id не должны повториться
+        m_nextOrderId = qMax(m_nextOrderId, order.getId() + 1);
+    }
+}
+
+void DataManager::appendOrderLocked(const Order &order)
+{
+    const int month = OrderPartitionStore::monthKey(order.getDate());
+    ensureMonthLoadedLocked(month);
+    m_orders.append(order);
+    m_orderColumns.append(order);
+    m_dirtyMonths.insert(month);
+}
+
+// Вызывается под блокировкой на запись и m_fileMutex
+bool DataManager::savePartitionsLocked()
+{
+    // Все пути записи проверяют m_readOnly раньше: клиент не должен трогать файлы сервиса
+    Q_ASSERT(!m_readOnly);
+    if (m_dirtyMonths.isEmpty()) {
+        return true;
+    }
+    
+    QHash<int, QList<Order>> byMonth;
+    for (const Order &order : m_orders) {
+        const int month = OrderPartitionStore::monthKey(order.getDate());
+        if (m_dirtyMonths.contains(month)) {
+            byMonth[month].append(order);
+        }
+    }
+    
+    bool ok = true;
+    for (auto it = m_dirtyMonths.begin(); it != m_dirtyMonths.end();) {
+        // Незагруженный (поврежденный) месяц нельзя перезаписывать частью заказов
+        if (m_loadedMonths.contains(*it) && m_partitions.writePartition(*it, byMonth.value(*it))) {
+            it = m_dirtyMonths.erase(it);
+        } else {
+            ok = false;
+            ++it;
+        }
+    }
+    return m_partitions.writeIndex() && ok;
+}
+
+std::optional<Category> DataManager::getCategoryById(int id) const
+{
+    PERF_SCOPE("DataManager::getCategoryById");
+    QReadLocker locker(&m_lock);
+    for (const auto &cat : m_categories) {
         if (cat.getId() == id) {
-            return &cat;
+            return cat;
         }
     }
-    return nullptr;
+    return std::nullopt;
 }
 
 void DataManager::addCategory(const Category &category)
 {
+    QWriteLocker locker(&m_lock);
     m_categories.append(category);
-    saveData();
+    ++m_mealsVersion;
+    saveDataLocked();
 }
 
 int DataManager::getNextUserId()
 {
+    QWriteLocker locker(&m_lock);
     return m_nextUserId++;
 }
 
 int DataManager::getNextMealId()
 {
+    QWriteLocker locker(&m_lock);
     return m_nextMealId++;
 }
 
 int DataManager::getNextOrderId()
 {
+    QWriteLocker locker(&m_lock);
     return m_nextOrderId++;
 }
 
 int DataManager::getNextCategoryId()
 {
+    QWriteLocker locker(&m_lock);
     return m_nextCategoryId++;
 }
 
-bool DataManager::exportMenu(const QString &filename)
+MemoryReport DataManager::getMemoryReport() const
 {
+    using namespace MemoryUsage;
+    QReadLocker locker(&m_lock);
+    MemoryReport report;
+    
+    MemoryUsageItem users{ "Пользователи", m_users.size(), listBytes(m_users) };
+    for (const User &user : m_users) {
+        users.bytes += stringBytes(user.getUsername()) + stringBytes(user.getPassword());
+    }
+    report.items.append(users);
+    
+    MemoryUsageItem meals{ "Блюда", m_meals.size(), listBytes(m_meals) };
+    for (const Meal &meal : m_meals) {
+        meals.bytes += stringBytes(meal.getName()) + stringBytes(meal.getImagePath());
+    }
+    report.items.append(meals);
+    
+    MemoryUsageItem categories{ "Категории", m_categories.size(), listBytes(m_categories) };
+    for (const Category &category : m_categories) {
+        categories.bytes += stringBytes(category.getName());
+    }
+    report.items.append(categories);
+    
+    // До четырех позиций хранятся внутри Order и учтены в строке заказов
+    report.items.append({ "Заказы (загруженные месяцы)", m_orders.size(), listBytes(m_orders) });
+    MemoryUsageItem lines{ "Позиции заказов (сверх 4 на заказ)", 0, 0 };
+    for (const Order &order : m_orders) {
+        lines.count += order.getMeals().size();
+        lines.bytes += varLengthArrayHeapBytes(order.getMeals());
+    }
+    report.items.append(lines);
+    
+    const qint64 columnBytes =
+        (m_orderColumns.days().capacity() + m_orderColumns.userIds().capacity()
+         + m_orderColumns.lineOffsets().capacity() + m_orderColumns.lineMealIds().capacity()
+         + m_orderColumns.lineQuantities().capacity()) * qint64(sizeof(qint32))
+        + m_orderColumns.totals().capacity() * qint64(sizeof(qint64))
+        + 6 * ArrayHeaderBytes;
+    report.items.append({ "Колонки заказов для отчетов", m_orderColumns.size(), columnBytes });
+    
+    const QMap<int, OrderPartitionSummary> &summaries = m_partitions.summaries();
+    MemoryUsageItem index{ "Индекс месяцев", summaries.size(), mapBytes(summaries) };
+    for (const OrderPartitionSummary &summary : summaries) {
+        index.bytes += hashBytes(summary.mealQuantities) + listBytes(summary.userIds)
+                       + mapBytes(summary.dailyCounts) + mapBytes(summary.dailyRevenue);
+    }
+    index.bytes += setBytes(m_loadedMonths) + setBytes(m_dirtyMonths);
+    report.items.append(index);
+    
+    int segmentCount = 0;
+    report.mappedBytes = m_partitions.mappedSegmentBytes(&segmentCount);
+    report.items.append({ "Кэш архивных сегментов", segmentCount,
+                          qint64(segmentCount) * qint64(sizeof(OrderSegment)) });
+    
+    report.currentRss = currentRss();
+    report.peakRss = peakRss();
+    report.peakRssAfterLoad = m_peakRssAfterLoad;
+    report.peakRssLastSave = m_peakRssLastSave;
+    return report;
+}
+
+bool DataManager::exportMenu(const QString &filename) const
+{
+    QReadLocker locker(&m_lock);
     QJsonObject root;
     
     QJsonArray categoriesArray;
@@ -360,71 +1297,104 @@ bool DataManager::exportMenu(const QString &filename)
     return false;
 }
 
-bool DataManager::importMenu(const QString &filename)
+MenuImportPlan DataManager::planMenuImport(const QString &filename) const
 {
     QFile file(filename);
     if (!file.open(QIODevice::ReadOnly)) {
-        return false;
+        MenuImportPlan plan;
+        plan.errors.append("Не удалось открыть файл: " + file.errorString());
+        return plan;
     }
     
-    QByteArray data = file.readAll();
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
     file.close();
+    if (!doc.isObject()) {
+        MenuImportPlan plan;
+        plan.errors.append("Некорректный JSON: " + parseError.errorString());
+        return plan;
+    }
     
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    QJsonObject root = doc.object();
+    QReadLocker locker(&m_lock);
+    MenuImportPlan plan = MenuImport::plan(doc.object(), m_categories, m_meals);
+    plan.mealsVersion = m_mealsVersion;
+    return plan;
+}
+
+bool DataManager::applyMenuImport(const MenuImportPlan &plan, QString *errorMessage)
+{
+    if (!plan.isValid()) {
+        if (errorMessage) {
+            *errorMessage = plan.errors.join("\n");
+        }
+        return false;
+    }
     
-    if (root.contains("categories")) {
-        QJsonArray categoriesArray = root["categories"].toArray();
-        for (const auto &value : categoriesArray) {
-            QJsonObject catObj = value.toObject();
-            int id = catObj["id"].toInt();
-            bool exists = false;
-            for (const Category &cat : m_categories) {
-                if (cat.getId() == id) {
-                    exists = true;
-                    break;
-                }
-            }
-            if (!exists) {
-                Category cat(id, catObj["name"].toString());
-                m_categories.append(cat);
-                if (cat.getId() >= m_nextCategoryId) {
-                    m_nextCategoryId = cat.getId() + 1;
-                }
-            }
+    QWriteLocker locker(&m_lock);
+    if (plan.mealsVersion != m_mealsVersion) {
+        if (errorMessage) {
+            *errorMessage = "Меню изменилось после проверки файла, повторите импорт";
         }
+        return false;
+    }
+    if (!plan.hasChanges()) {
+        return true;
     }
     
-    if (root.contains("meals")) {
-        QJsonArray mealsArray = root["meals"].toArray();
-        for (const auto &value : mealsArray) {
-            QJsonObject mealObj = value.toObject();
-            Meal meal(
-                mealObj["id"].toInt(),
-                mealObj["name"].toString(),
-                mealObj["price"].toDouble(),
-                mealObj["categoryId"].toInt(),
-                mealObj.contains("imagePath") ? mealObj["imagePath"].toString() : QString()
-            );
-            
-            bool exists = false;
-            for (int i = 0; i < m_meals.size(); ++i) {
-                if (m_meals[i].getId() == meal.getId()) {
-                    m_meals[i] = meal;
-                    exists = true;
-                    break;
-                }
-            }
-            if (!exists) {
-                m_meals.append(meal);
-            }
-            if (meal.getId() >= m_nextMealId) {
-                m_nextMealId = meal.getId() + 1;
-            }
+    QHash<int, qsizetype> categoryIndex;
+    categoryIndex.reserve(m_categories.size());
+    for (qsizetype i = 0; i < m_categories.size(); ++i) {
+        categoryIndex.insert(m_categories[i].getId(), i);
+    }
+    for (const Category &category : plan.updatedCategories) {
+        m_categories[categoryIndex.value(category.getId())] = category;
+    }
+    // Временные id новых категорий заменяются настоящими, ссылки блюд - вслед за ними
+    QHash<int, int> assignedCategoryIds;
+    for (Category category : plan.addedCategories) {
+        if (category.getId() <= 0) {
+            assignedCategoryIds.insert(category.getId(), m_nextCategoryId);
+            category = Category(m_nextCategoryId, category.getName());
+        }
+        m_nextCategoryId = qMax(m_nextCategoryId, category.getId() + 1);
+        m_categories.append(category);
+    }
+    
+    QHash<int, qsizetype> mealIndex;
+    mealIndex.reserve(m_meals.size());
+    for (qsizetype i = 0; i < m_meals.size(); ++i) {
+        mealIndex.insert(m_meals[i].getId(), i);
+    }
+    for (Meal meal : plan.updatedMeals) {
+        if (meal.getCategoryId() < 0) {
+            meal.setCategoryId(assignedCategoryIds.value(meal.getCategoryId()));
+        }
+        m_meals[mealIndex.value(meal.getId())] = meal;
+    }
+    m_meals.reserve(m_meals.size() + plan.addedMeals.size());
+    for (Meal meal : plan.addedMeals) {
+        if (meal.getCategoryId() < 0) {
+            meal.setCategoryId(assignedCategoryIds.value(meal.getCategoryId()));
         }
+        if (meal.getId() <= 0) {
+            meal = Meal(m_nextMealId, meal.getName(), meal.getPrice(), meal.getCategoryId(), meal.getImagePath());
+        }
+        m_nextMealId = qMax(m_nextMealId, meal.getId() + 1);
+        m_meals.append(meal);
     }
     
-    saveData();
+    ++m_mealsVersion;
+    saveDataLocked();
+    return true;
+}
+
+bool DataManager::importMenu(const QString &filename)
+{
+    QString errorMessage;
+    if (!applyMenuImport(planMenuImport(filename), &errorMessage)) {
+        qWarning() << "Menu import failed:" << errorMessage;
+        return false;
+    }
     return true;
 }
 
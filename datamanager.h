@@ -5,40 +5,144 @@
 #include "meal.h"
 #include "order.h"
 #include "category.h"
+#include "ordercolumns.h"
+#include "groupcommitter.h"
+#include "snapshotstore.h"
+#include "orderpartitions.h"
+#include "menuimport.h"
+#include "rosterimport.h"
+#include "memoryusage.h"
 #include <QString>
 #include <QList>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QFuture>
+#include <atomic>
+#include <optional>
+
+// Заказ на оформление и его результат (для пакетного DataManager::placeOrders)
+struct OrderRequest
+{
+    int userId;
+    QList<OrderLine> cart;
+};
+
+struct OrderResult
+{
+    std::optional<Order> order; // пусто, если заказ отклонен
+    Money balance;              // баланс пользователя после заказа
+    QString error;
+};
+
+// Политика архивации: месяцы старше horizonMonths переносятся в архивные сегменты (OrderSegment)
+struct ArchivePolicy
+{
+    int horizonMonths = 12;
+    bool automatic = false; // архивировать по расписанию из AdminWindow
+};
+
+// Ход фоновой миграции открытых паролей (DataManager::startPasswordMigration)
+struct PasswordMigrationProgress
+{
+    int done = 0;
+    int total = 0;
+};
 
+// Потокобезопасен: чтение - под разделяемой блокировкой, изменения - под исключительной.
+// Наружу отдаются только копии (коллекции Qt разделяются неявно, копирование дешевое).
 class DataManager
 {
 public:
     static DataManager& getInstance();
+    // Каталог данных: задается до первого getInstance() (ключ --data-dir).
+    // Иначе - CANTEEN_DATA_DIR, затем каталог программы, если файл данных лежит там,
+    // затем стандартный каталог данных приложения (QStandardPaths::AppDataLocation);
+    // если и там файла нет, а он лежит в прежнем месте (каталог с CMakeLists.txt), берется оно.
+    static void setDataDirectory(const QString &directory);
+    // Изменять файлы данных может только один процесс: сервис заказов либо программа
+    // без сервиса. Блокировка (файл .lock в каталоге данных) держится до выхода из процесса;
+    // false - данные уже открыты на запись другим процессом. Вызывается до getInstance().
+    static bool lockForWriting();
+    // Клиентский режим: данные только читаются, изменения идут через сервис заказов.
+    // Задается до первого getInstance(), чтобы и первая загрузка ничего не записала.
+    static void setReadOnly(bool readOnly);
     
     void loadData();
     void saveData();
+    // Есть ли транзакции журнала, еще не вошедшие в снимок
+    bool hasJournalRecords();
     
     // Users
-    QList<User> getUsers() const { return m_users; }
-    User* findUser(const QString &username, const QString &password);
-    User* getUserById(int id);
+    QList<User> getUsers() const { QReadLocker locker(&m_lock); return m_users; }
+    std::optional<User> findUser(const QString &username, const QString &password) const;
+    std::optional<User> getUserById(int id) const;
     void addUser(const User &user);
     void updateUser(const User &user);
+    // Массовая регистрация учеников: пароли должны быть уже захэшированы
+    // (RosterImport::hashPasswords, вне блокировки). Занятые логины пропускаются,
+    // id выделяются одним блоком, данные сохраняются один раз.
+    RosterImportResult addStudents(const QList<RosterEntry> &entries);
+    // Однократная фоновая миграция паролей, оставшихся открытым текстом в старых файлах:
+    // хэширование идет в пуле потоков, результат сохраняется одним снимком.
+    // До ее завершения такие пользователи входят по открытому паролю (User::verifyPassword).
+    QFuture<void> startPasswordMigration();
+    void waitForPasswordMigration();
+    PasswordMigrationProgress getPasswordMigrationProgress() const;
     
     // Meals
-    QList<Meal> getMeals() const { return m_meals; }
-    Meal* getMealById(int id);
+    QList<Meal> getMeals() const { QReadLocker locker(&m_lock); return m_meals; }
+    // Блюда вместе с версией меню (меняется при любом изменении меню), взятые под одной
+    // блокировкой: по версии кэшируется сортировка именно этого списка
+    QList<Meal> getMeals(quint64 *version) const
+    {
+        QReadLocker locker(&m_lock);
+        *version = m_mealsVersion;
+        return m_meals;
+    }
+    std::optional<Meal> getMealById(int id) const;
     void addMeal(const Meal &meal);
     void updateMeal(const Meal &meal);
     void removeMeal(int id);
     
     // Orders
-    QList<Order> getOrders() const { return m_orders; }
+    // Заказы хранятся помесячно; при запуске загружается только текущий месяц и
+    // сводки по остальным. Запросы ниже сами догружают нужные месяцы с диска.
+    // getOrders и getOrderColumns возвращают рабочие (неархивные) заказы;
+    // архивные месяцы отчеты сканируют по отображенным сегментам (getArchive).
+    QList<Order> getOrders();
+    OrderColumns getOrderColumns();
     void addOrder(const Order &order);
-    QList<Order> getOrdersByUserId(int userId) const;
-    QList<Order> getOrdersByDate(const QDate &date) const;
+    QList<Order> getOrdersByUserId(int userId);
+    QList<Order> getOrdersByDate(const QDate &date);
+    QList<Order> getOrdersInRange(const QDate &from, const QDate &to);
+    QMap<int, OrderPartitionSummary> getOrderSummaries() const;
+    OrderArchive getArchive() const;
+    
+    // Архивация: переносит месяцы, целиком лежащие раньше horizon, в архивные сегменты.
+    // Возвращает число перенесенных месяцев или -1 при ошибке (причина - в errorMessage).
+    int archiveOrdersBefore(const QDate &horizon, QString *errorMessage = nullptr);
+    int archiveExpiredOrders(QString *errorMessage = nullptr); // по текущей политике
+    ArchivePolicy getArchivePolicy() const;
+    void setArchivePolicy(const ArchivePolicy &policy);
+    
+    // Оформление заказа одной транзакцией: цены берутся из текущего меню, списание
+    // с баланса и сам заказ фиксируются одной записью журнала (с fsync).
+    // Возвращает сохраненный заказ или пустое значение, причина - в errorMessage.
+    std::optional<Order> placeOrder(int userId, const QList<OrderLine> &cart, QString *errorMessage = nullptr);
+    // Пакет заказов проверяется по очереди (балансы учитывают предыдущие заказы пакета),
+    // принятые фиксируются одной записью в журнал и одним fsync.
+    // Одновременные вызовы из разных потоков тоже объединяются в общий fsync (GroupCommitter);
+    // результат возвращается только после того, как записи легли на диск.
+    QList<OrderResult> placeOrders(const QList<OrderRequest> &requests);
+    
+    // true в клиентском режиме, а также если ни одно поколение снимка не прочиталось
+    bool isReadOnly() const;
     
     // Categories
-    QList<Category> getCategories() const { return m_categories; }
-    Category* getCategoryById(int id);
+    QList<Category> getCategories() const { QReadLocker locker(&m_lock); return m_categories; }
+    std::optional<Category> getCategoryById(int id) const;
     void addCategory(const Category &category);
     
     int getNextUserId();
@@ -46,7 +150,15 @@ public:
     int getNextOrderId();
     int getNextCategoryId();
     
-    bool exportMenu(const QString &filename);
+    // Приблизительный объем памяти по коллекциям и RSS процесса (см. memoryusage.h)
+    MemoryReport getMemoryReport() const;
+    
+    bool exportMenu(const QString &filename) const;
+    // Импорт меню в два шага: planMenuImport читает файл и строит план (ничего не меняя),
+    // applyMenuImport применяет его одним сохранением. План отклоняется, если в нем есть
+    // ошибки или меню изменилось после его построения.
+    MenuImportPlan planMenuImport(const QString &filename) const;
+    bool applyMenuImport(const MenuImportPlan &plan, QString *errorMessage = nullptr);
     bool importMenu(const QString &filename);
 
 private:
@@ -55,16 +167,64 @@ private:
     DataManager(const DataManager&) = delete;
     DataManager& operator=(const DataManager&) = delete;
     
+    static QString resolveDataDirectory();
+    
+    // Вызываются под m_lock (чтение или запись), сами блокировку не берут;
+    // loadDataLocked и saveDataLocked - только под блокировкой на запись
+    void loadDataLocked();
+    void saveDataLocked();
+    // Возвращает данные к состоянию до загрузки (как после конструктора)
+    void resetLocked();
+    User* userByIdLocked(int id);
+    Meal* mealByIdLocked(int id);
+    QString priceCartLocked(const QList<OrderLine> &cart, Money *total);
+    void rollbackOrdersLocked(QList<OrderResult> &results);
+    void migratePasswords();
+    
+    // Догрузка месяцев заказов; ensureMonthsLoaded берет блокировку сама
+    void ensureMonthsLoaded(const QList<int> &months);
+    void ensureMonthLoadedLocked(int month);
+    bool isMonthLoadedLocked(int month) const;
+    void appendOrderLocked(const Order &order);
+    bool savePartitionsLocked();
+    
+    // Журнал транзакций между полными сохранениями; очищается после saveData().
+    // committedNextOrderId - граница заказов, которые вместе с балансами уже есть в снимке
+    bool appendJournal(const QByteArray &records);
+    void replayJournal(int committedNextOrderId);
+    void truncateJournal();
+    
+    mutable QReadWriteLock m_lock;
+    QMutex m_fileMutex; // сериализует запись снимка и журнала
+    GroupCommitter m_journalCommitter;
+    QMutex m_migrationMutex;
+    QFuture<void> m_passwordMigration;
+    std::atomic<int> m_migrationDone{0};
+    std::atomic<int> m_migrationTotal{0};
+    
     QString m_dataFile;
+    QString m_journalFile;
+    SnapshotStore m_snapshots;
     QList<User> m_users;
     QList<Meal> m_meals;
-    QList<Order> m_orders;
+    QList<Order> m_orders;          // только загруженные месяцы
+    OrderColumns m_orderColumns;
+    OrderPartitionStore m_partitions;
+    QSet<int> m_loadedMonths;
+    QSet<int> m_dirtyMonths;        // изменены после последнего сохранения
+    ArchivePolicy m_archivePolicy;
     QList<Category> m_categories;
     
     int m_nextUserId;
     int m_nextMealId;
     int m_nextOrderId;
     int m_nextCategoryId;
+    
+    quint64 m_mealsVersion;
+    bool m_readOnly;
+    
+    qint64 m_peakRssAfterLoad;
+    qint64 m_peakRssLastSave;
 };
 
 #endif // DATAMANAGER_H
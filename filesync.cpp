@@ -0,0 +1,39 @@
+#include "filesync.h"
+#include <QFileDevice>
+#include <QFile>
+#include <QString>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool syncToDisk(QFileDevice &file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool syncDirectory(const QString &dirPath)
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED(dirPath);
+    return true;
+#else
+    const int fd = ::open(QFile::encodeName(dirPath).constData(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
@@ -0,0 +1,14 @@
+#ifndef FILESYNC_H
+#define FILESYNC_H
+
+class QFileDevice;
+class QString;
+
+// Сбрасывает буферы файла и дожидается записи данных на диск (fsync / _commit)
+bool syncToDisk(QFileDevice &file);
+
+// Фиксирует на диске запись каталога (после переименования файлов в нем).
+// На Windows не требуется и всегда возвращает true.
+bool syncDirectory(const QString &dirPath);
+
+#endif // FILESYNC_H
@@ -0,0 +1,92 @@
+#include "groupcommitter.h"
+#include <QDeadlineTimer>
+#include <chrono>
+
+GroupCommitter::GroupCommitter(WriteFunction write)
+    : m_write(std::move(write))
+    , m_batchWindowUs(200)
+    , m_maxBatchRecords(256)
+    , m_pendingRecords(0)
+    , m_lastTicket(0)
+    , m_committedTicket(0)
+    , m_flushing(false)
+{
+}
+
+void GroupCommitter::setBatchWindow(int microseconds)
+{
+    QMutexLocker locker(&m_mutex);
+    m_batchWindowUs = microseconds;
+}
+
+void GroupCommitter::setMaxBatchRecords(int records)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxBatchRecords = records;
+}
+
+quint64 GroupCommitter::submit(const QByteArray &records, int recordCount)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending += records;
+    m_pendingRecords += recordCount;
+    if (m_pendingRecords >= m_maxBatchRecords) {
+        m_arrived.wakeAll();
+    }
+    return ++m_lastTicket;
+}
+
+bool GroupCommitter::waitForCommit(quint64 ticket)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_committedTicket < ticket) {
+        if (!m_flushing) {
+            flushLocked();
+        } else {
+            m_committed.wait(&m_mutex);
+        }
+    }
+    return !isFailed(ticket);
+}
+
+// Вызывается под m_mutex; на время записи мьютекс отпускается
+void GroupCommitter::flushLocked()
+{
+    m_flushing = true;
+
+    if (m_batchWindowUs > 0 && m_pendingRecords < m_maxBatchRecords) {
+        QDeadlineTimer deadline(std::chrono::microseconds(m_batchWindowUs));
+        while (m_pendingRecords < m_maxBatchRecords && m_arrived.wait(&m_mutex, deadline)) {
+        }
+    }
+
+    const QByteArray batch = std::move(m_pending);
+    m_pending.clear();
+    m_pendingRecords = 0;
+    const quint64 firstTicket = m_committedTicket + 1;
+    const quint64 lastTicket = m_lastTicket;
+
+    m_mutex.unlock();
+    const bool ok = m_write(batch);
+    m_mutex.lock();
+
+    if (!ok) {
+        m_failedBatches.append(qMakePair(firstTicket, lastTicket));
+        if (m_failedBatches.size() > MaxFailedBatches) {
+            m_failedBatches.removeFirst();
+        }
+    }
+    m_committedTicket = lastTicket;
+    m_flushing = false;
+    m_committed.wakeAll();
+}
+
+bool GroupCommitter::isFailed(quint64 ticket) const
+{
+    for (const auto &range : m_failedBatches) {
+        if (ticket >= range.first && ticket <= range.second) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,57 @@
+#ifndef GROUPCOMMITTER_H
+#define GROUPCOMMITTER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+
+// Групповая фиксация записей журнала для нескольких потоков.
+// Поток кладет записи через submit() и ждет waitForCommit(). Первый ожидающий
+// становится ведущим: забирает все накопленные записи и пишет их одним вызовом
+// write (одна запись в файл и один fsync), остальные ждут результат этого сброса.
+// Пока идет fsync, следующие записи копятся и уходят следующим пакетом, поэтому
+// число fsync растет с числом пакетов, а не с числом заказов.
+class GroupCommitter
+{
+public:
+    using WriteFunction = std::function<bool(const QByteArray &records)>;
+
+    explicit GroupCommitter(WriteFunction write);
+
+    // Сколько ведущий ждет попутчиков перед сбросом и предельный размер пакета
+    void setBatchWindow(int microseconds);
+    void setMaxBatchRecords(int records);
+
+    // Ставит записи в очередь, возвращает номер для waitForCommit().
+    // Порядок записей в журнале совпадает с порядком вызовов submit().
+    quint64 submit(const QByteArray &records, int recordCount);
+    // Возвращает управление после сброса пакета с этими записями;
+    // false - запись или fsync не удались
+    bool waitForCommit(quint64 ticket);
+
+private:
+    void flushLocked();
+    bool isFailed(quint64 ticket) const;
+
+    static constexpr int MaxFailedBatches = 64;
+
+    WriteFunction m_write;
+    int m_batchWindowUs;
+    int m_maxBatchRecords;
+
+    QMutex m_mutex;
+    QWaitCondition m_arrived;   // появились новые записи
+    QWaitCondition m_committed; // пакет сброшен
+
+    QByteArray m_pending;
+    int m_pendingRecords;
+    quint64 m_lastTicket;      // последний выданный номер
+    quint64 m_committedTicket; // все номера до него включительно сброшены (успешно или нет)
+    bool m_flushing;
+    QList<QPair<quint64, quint64>> m_failedBatches; // диапазоны номеров неудачных пакетов
+};
+
+#endif // GROUPCOMMITTER_H
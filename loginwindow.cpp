@@ -4,7 +4,6 @@
 
 LoginWindow::LoginWindow(QWidget *parent)
     : QDialog(parent)
-    , m_loggedInUser(nullptr)
 {
     setupUI();
     setWindowTitle("Вход в систему");
@@ -91,11 +90,11 @@ void LoginWindow::onLoginClicked()
     }
     
     DataManager &dm = DataManager::getInstance();
-    User *user = dm.findUser(username, password);
+    std::optional<User> user = dm.findUser(username, password);
     
     if (user) {
         m_loggedInUser = user;
-        emit loginSuccessful(user);
+        emit loginSuccessful(&*m_loggedInUser);
         accept();
     } else {
         QMessageBox::warning(this, "Ошибка", "Неверное имя пользователя или пароль");
@@ -114,6 +113,10 @@ void LoginWindow::onRegisterClicked()
     }
     
     DataManager &dm = DataManager::getInstance();
+    if (dm.isReadOnly()) {
+        QMessageBox::warning(this, "Ошибка", "Регистрация доступна только на компьютере с сервисом заказов");
+        return;
+    }
     
     for (const User &u : dm.getUsers()) {
         if (u.getUsername() == username) {
@@ -122,7 +125,7 @@ void LoginWindow::onRegisterClicked()
         }
     }
     
-    User newUser(dm.getNextUserId(), username, password, UserType::Student, 1000.0);
+    User newUser(dm.getNextUserId(), username, User::hashPassword(password), UserType::Student, Money::fromRubles(1000));
     dm.addUser(newUser);
     
     QMessageBox::information(this, "Успех", "Регистрация выполнена успешно. Ваш начальный баланс: 1000 руб.");
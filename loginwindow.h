@@ -9,6 +9,7 @@
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include "user.h"
+#include <optional>
 
 class LoginWindow : public QDialog
 {
@@ -18,7 +19,8 @@ public:
     explicit LoginWindow(QWidget *parent = nullptr);
     ~LoginWindow();
     
-    User* getLoggedInUser() const { return m_loggedInUser; }
+    // Копия пользователя на время сеанса; DataManager указателей на свои данные не отдает
+    User* getLoggedInUser() { return m_loggedInUser ? &*m_loggedInUser : nullptr; }
 
 signals:
     void loginSuccessful(User* user);
@@ -32,7 +34,7 @@ private:
     QLineEdit *m_passwordEdit;
     QPushButton *m_loginButton;
     QPushButton *m_registerButton;
-    User *m_loggedInUser;
+    std::optional<User> m_loggedInUser;
     
     void setupUI();
 };
@@ -3,31 +3,195 @@
 #include "studentwindow.h"
 #include "user.h"
 #include "datamanager.h"
+#include "orderservice.h"
+#include "orderserviceclient.h"
+#include "orderprotocol.h"
+#include "traceevents.h"
+#include "startupprofiler.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
 #include <QMessageBox>
+#include <QTimer>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+bool hasArgument(int argc, char *argv[], const char *name)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void setupCommandLine(QCommandLineParser &parser)
+{
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("serve", "Запустить сервис заказов без интерфейса"));
+    parser.addOption(QCommandLineOption("connect", "Режим киоска: заказы оформляются через сервис заказов"));
+    parser.addOption(QCommandLineOption("server-name", "Имя локального сервера заказов", "name",
+                                        OrderProtocol::defaultServerName()));
+    parser.addOption(QCommandLineOption("data-dir", "Каталог файлов данных", "dir"));
+    parser.addOption(QCommandLineOption("snapshot-interval", "Период полного сохранения в сервисе, секунды",
+                                        "seconds", "300"));
+    parser.addOption(QCommandLineOption("startup-benchmark",
+                                        "Замерить холодный старт до готового окна входа и выйти"));
+    parser.addOption(QCommandLineOption("trace", "Записать трассировку Chrome Trace Event в файл", "file"));
+}
+
+// Трассировка по ключу --trace или переменной CANTEEN_TRACE; файл пишется при выходе из main
+struct TraceSession
+{
+    explicit TraceSession(const QCommandLineParser &parser)
+    {
+        if (parser.isSet("trace")) {
+            TraceEvents::start(parser.value("trace"), qEnvironmentVariableIntValue("CANTEEN_TRACE_EVENTS"));
+        } else {
+            TraceEvents::startFromEnvironment();
+        }
+    }
+    ~TraceSession()
+    {
+        QString errorMessage;
+        if (!TraceEvents::stop(&errorMessage)) {
+            qWarning() << "Trace: failed to write:" << errorMessage;
+        }
+    }
+};
+
+// Дожидается фоновой миграции паролей при любом выходе из main, пока жив пул потоков
+struct PasswordMigrationGuard
+{
+    ~PasswordMigrationGuard() { DataManager::getInstance().waitForPasswordMigration(); }
+};
+
+// Сервис заказов: владеет данными, окна не создаются
+int runOrderService(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCommandLineParser parser;
+    setupCommandLine(parser);
+    parser.process(a);
+    TraceSession traceSession(parser);
+    if (parser.isSet("data-dir")) {
+        DataManager::setDataDirectory(parser.value("data-dir"));
+    }
+    if (!DataManager::lockForWriting()) {
+        qCritical() << "Данные уже открыты на запись другим процессом (сервисом или программой без --connect)";
+        return 1;
+    }
+
+    DataManager &dm = DataManager::getInstance();
+    PasswordMigrationGuard migrationGuard;
+    dm.startPasswordMigration();
+
+    // Периодический снимок, чтобы журнал не рос без ограничений
+    QTimer snapshotTimer;
+    QObject::connect(&snapshotTimer, &QTimer::timeout, [&dm]() {
+        if (dm.hasJournalRecords()) {
+            dm.saveData();
+        }
+    });
+    snapshotTimer.start(qMax(1, parser.value("snapshot-interval").toInt()) * 1000);
+
+    OrderService service;
+    const QString serverName = parser.value("server-name");
+    if (!service.listen(serverName)) {
+        qCritical() << "Не удалось запустить сервис заказов:" << service.errorString();
+        return 1;
+    }
+    qInfo() << "Сервис заказов слушает" << serverName;
+
+    int result = a.exec();
+    dm.saveData();
+    return result;
+}
+
+}
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler::start();
+    if (hasArgument(argc, argv, "--serve")) {
+        return runOrderService(argc, argv);
+    }
+
     QApplication a(argc, argv);
-    
-    DataManager::getInstance();
-    
+    QCommandLineParser parser;
+    setupCommandLine(parser);
+    parser.process(a);
+    TraceSession traceSession(parser);
+    if (parser.isSet("data-dir")) {
+        DataManager::setDataDirectory(parser.value("data-dir"));
+    }
+
+    // Без сервиса программа сама пишет файлы данных: второй такой процесс (или сервис)
+    // затер бы ее изменения своим снимком и очисткой журнала
+    const bool clientMode = parser.isSet("connect");
+    if (!clientMode && !DataManager::lockForWriting()) {
+        QMessageBox::critical(nullptr, "Ошибка",
+                              "Данные уже открыты сервисом заказов или другой копией программы.\n"
+                              "Для оформления заказов запустите киоск с ключом --connect, "
+                              "для управления меню остановите сервис.");
+        return 1;
+    }
+    // Данные файла только читаются; все изменения проходят через сервис
+    DataManager::setReadOnly(clientMode);
+
+    DataManager &dm = DataManager::getInstance();
+    StartupProfiler::mark("data loaded");
+
+    OrderServiceClient orderClient;
+    if (clientMode) {
+        if (!orderClient.connectToServer(parser.value("server-name"))) {
+            QMessageBox::critical(nullptr, "Ошибка", "Не удалось подключиться к сервису заказов");
+            return 1;
+        }
+    }
+    PasswordMigrationGuard migrationGuard;
+    if (!clientMode) {
+        dm.startPasswordMigration();
+    }
+
     LoginWindow loginWindow;
+    if (parser.isSet("startup-benchmark")) {
+        StartupProfiler::markFirstFrame(&loginWindow, "login window interactive", [&loginWindow]() {
+            loginWindow.reject();
+        });
+        loginWindow.exec();
+        return 0;
+    }
+    StartupProfiler::markFirstFrame(&loginWindow, "login window interactive");
     if (loginWindow.exec() == QDialog::Accepted) {
+        StartupProfiler::mark("login accepted");
         User *user = loginWindow.getLoggedInUser();
         if (user) {
             if (user->getType() == UserType::Admin) {
+                if (clientMode) {
+                    QMessageBox::warning(nullptr, "Ошибка",
+                                         "Управление доступно только на компьютере с сервисом заказов");
+                    return 0;
+                }
                 AdminWindow adminWindow(user);
                 adminWindow.show();
+                StartupProfiler::markFirstFrame(&adminWindow, "admin window interactive");
                 return a.exec();
             } else if (user->getType() == UserType::Student) {
                 StudentWindow studentWindow(user);
+                if (clientMode) {
+                    studentWindow.setOrderServiceClient(&orderClient);
+                }
                 studentWindow.show();
+                StartupProfiler::markFirstFrame(&studentWindow, "student window interactive");
                 return a.exec();
             }
         }
     }
-    
+
     return 0;
 }
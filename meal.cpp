@@ -2,8 +2,8 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 
-Meal::Meal(int id, const QString &name, double price, int categoryId, const QString &imagePath)
-    : m_id(id), m_name(name), m_price(price), m_categoryId(categoryId), m_imagePath(imagePath)
+Meal::Meal(int id, QString name, Money price, int categoryId, QString imagePath)
+    : m_id(id), m_name(std::move(name)), m_price(price), m_categoryId(categoryId), m_imagePath(std::move(imagePath))
 {
 }
 
@@ -12,7 +12,7 @@ QString Meal::toJson() const
     QJsonObject obj;
     obj["id"] = m_id;
     obj["name"] = m_name;
-    obj["price"] = m_price;
+    obj["priceKopecks"] = m_price.kopecks();
     obj["categoryId"] = m_categoryId;
     obj["imagePath"] = m_imagePath;
     
@@ -28,7 +28,7 @@ Meal Meal::fromJson(const QString &json)
     return Meal(
         obj["id"].toInt(),
         obj["name"].toString(),
-        obj["price"].toDouble(),
+        Money::fromJson(obj, "priceKopecks", "price"),
         obj["categoryId"].toInt(),
         obj.contains("imagePath") ? obj["imagePath"].toString() : QString()
     );
@@ -2,22 +2,24 @@
 #define MEAL_H
 
 #include <QString>
+#include <utility>
+#include "money.h"
 
 class Meal
 {
 public:
-    Meal(int id, const QString &name, double price, int categoryId, const QString &imagePath = QString());
+    Meal(int id, QString name, Money price, int categoryId, QString imagePath = QString());
     
     int getId() const { return m_id; }
-    QString getName() const { return m_name; }
-    double getPrice() const { return m_price; }
+    const QString &getName() const { return m_name; }
+    Money getPrice() const { return m_price; }
     int getCategoryId() const { return m_categoryId; }
-    QString getImagePath() const { return m_imagePath; }
+    const QString &getImagePath() const { return m_imagePath; }
     
-    void setName(const QString &name) { m_name = name; }
-    void setPrice(double price) { m_price = price; }
+    void setName(QString name) { m_name = std::move(name); }
+    void setPrice(Money price) { m_price = price; }
     void setCategoryId(int categoryId) { m_categoryId = categoryId; }
-    void setImagePath(const QString &imagePath) { m_imagePath = imagePath; }
+    void setImagePath(QString imagePath) { m_imagePath = std::move(imagePath); }
     
     QString toJson() const;
     static Meal fromJson(const QString &json);
@@ -25,7 +27,7 @@ public:
 private:
     int m_id;
     QString m_name;
-    double m_price;
+    Money m_price;
     int m_categoryId;
     QString m_imagePath;
 };
@@ -0,0 +1,117 @@
+#include "memoryusage.h"
+#include <QFile>
+#include <atomic>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+qint64 MemoryReport::totalBytes() const
+{
+    qint64 total = 0;
+    for (const MemoryUsageItem &item : items) {
+        total += item.bytes;
+    }
+    return total;
+}
+
+namespace MemoryUsage {
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// Значение поля из /proc/self/status ("VmRSS:   12345 kB") в байтах
+qint64 procStatusBytes(const char *field)
+{
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QByteArray prefix = QByteArray(field) + ':';
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (line.startsWith(prefix)) {
+            const QList<QByteArray> parts = line.mid(prefix.size()).simplified().split(' ');
+            return parts.value(0).toLongLong() * 1024;
+        }
+    }
+    return 0;
+}
+
+// Наибольший пик процесса до последнего сброса VmHWM
+std::atomic<qint64> earlierPeak{0};
+
+void rememberPeak(qint64 peak)
+{
+    qint64 seen = earlierPeak.load();
+    while (peak > seen && !earlierPeak.compare_exchange_weak(seen, peak)) {
+    }
+}
+#endif
+
+}
+
+qint64 currentRss()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.WorkingSetSize);
+    }
+    return 0;
+#elif defined(Q_OS_LINUX)
+    return procStatusBytes("VmRSS");
+#else
+    return 0;
+#endif
+}
+
+qint64 peakRss()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#elif defined(Q_OS_LINUX)
+    return qMax(earlierPeak.load(), procStatusBytes("VmHWM"));
+#elif defined(Q_OS_UNIX)
+    // ru_maxrss на macOS - в байтах, на BSD - в килобайтах
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(Q_OS_DARWIN)
+    return qint64(usage.ru_maxrss);
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+PeakRssScope::PeakRssScope()
+    : m_reset(false)
+{
+#ifdef Q_OS_LINUX
+    rememberPeak(procStatusBytes("VmHWM"));
+    QFile clearRefs("/proc/self/clear_refs");
+    m_reset = clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5", 1) == 1;
+#endif
+}
+
+qint64 PeakRssScope::peak() const
+{
+#ifdef Q_OS_LINUX
+    return m_reset ? procStatusBytes("VmHWM") : 0;
+#else
+    return 0;
+#endif
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QVarLengthArray>
+
+// Приблизительный учет памяти коллекций: считается объем, выделенный под элементы
+// (по capacity) и строки, плюс заголовки общих данных Qt. Накладные расходы
+// распределителя памяти не учитываются, поэтому сумма меньше реального RSS.
+struct MemoryUsageItem
+{
+    QString name;
+    qint64 count = 0;   // число элементов
+    qint64 bytes = 0;
+};
+
+struct MemoryReport
+{
+    QList<MemoryUsageItem> items;
+    qint64 mappedBytes = 0;         // архивные сегменты, отображенные в память (страницы делятся с кэшем ОС)
+    qint64 currentRss = 0;          // 0, если ОС не сообщает
+    qint64 peakRss = 0;             // за все время работы процесса
+    qint64 peakRssAfterLoad = 0;    // пиковый RSS за время последней loadData (0 - ОС не умеет сбрасывать пик)
+    qint64 peakRssLastSave = 0;     // пиковый RSS за время последней saveData (0 - не было или не измерено)
+
+    qint64 totalBytes() const;
+};
+
+namespace MemoryUsage {
+
+// Заголовок блока общих данных Qt (QArrayData / узлы хэша) - оценка
+constexpr qint64 ArrayHeaderBytes = 16;
+constexpr qint64 HashNodeOverheadBytes = 16;
+
+qint64 currentRss();
+// Пиковый RSS за все время работы процесса, включая пики до сбросов PeakRssScope
+qint64 peakRss();
+
+// Пиковый RSS за время жизни объекта - одной загрузки или сохранения. На Linux пик процесса
+// (VmHWM) сбрасывается до текущего RSS записью "5" в /proc/self/clear_refs; прежний пик
+// запоминается для peakRss(). Где сбросить пик нельзя, peak() возвращает 0, а не пик за
+// всю жизнь процесса. Одновременные измерения мешают друг другу: DataManager ведет их
+// под блокировкой на запись.
+class PeakRssScope
+{
+public:
+    PeakRssScope();
+    qint64 peak() const;
+
+private:
+    bool m_reset;
+};
+
+inline qint64 stringBytes(const QString &s)
+{
+    return s.isNull() ? 0 : ArrayHeaderBytes + (qint64(s.capacity()) + 1) * qint64(sizeof(QChar));
+}
+
+// Память под элементы списка, без памяти, на которую ссылаются сами элементы
+template <typename T>
+qint64 listBytes(const QList<T> &list)
+{
+    return list.capacity() ? ArrayHeaderBytes + qint64(list.capacity()) * qint64(sizeof(T)) : 0;
+}
+
+template <typename T, qsizetype Prealloc>
+qint64 varLengthArrayHeapBytes(const QVarLengthArray<T, Prealloc> &array)
+{
+    return array.capacity() > Prealloc ? qint64(array.capacity()) * qint64(sizeof(T)) : 0;
+}
+
+template <typename K, typename V>
+qint64 hashBytes(const QHash<K, V> &hash)
+{
+    return qint64(hash.capacity()) * qint64(sizeof(void *))
+           + qint64(hash.size()) * (qint64(sizeof(K) + sizeof(V)) + HashNodeOverheadBytes);
+}
+
+template <typename T>
+qint64 setBytes(const QSet<T> &set)
+{
+    return qint64(set.capacity()) * qint64(sizeof(void *))
+           + qint64(set.size()) * (qint64(sizeof(T)) + HashNodeOverheadBytes);
+}
+
+// QMap - красно-черное дерево: узел с тремя указателями и цветом
+template <typename K, typename V>
+qint64 mapBytes(const QMap<K, V> &map)
+{
+    return qint64(map.size()) * (qint64(sizeof(K) + sizeof(V)) + 4 * qint64(sizeof(void *)));
+}
+
+}
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,179 @@
+#include "menuimport.h"
+#include "stringpool.h"
+#include <QHash>
+#include <QSet>
+#include <QJsonArray>
+
+namespace {
+
+QString nameKey(const QString &name)
+{
+    return name.trimmed().toCaseFolded();
+}
+
+bool sameMeal(const Meal &a, const Meal &b)
+{
+    return StringPool::equal(a.getName(), b.getName())
+           && a.getPrice() == b.getPrice()
+           && a.getCategoryId() == b.getCategoryId()
+           && StringPool::equal(a.getImagePath(), b.getImagePath());
+}
+
+}
+
+bool MenuImportPlan::hasChanges() const
+{
+    return !addedCategories.isEmpty() || !updatedCategories.isEmpty()
+           || !addedMeals.isEmpty() || !updatedMeals.isEmpty();
+}
+
+QString MenuImportPlan::summary() const
+{
+    return QString("Категории: добавить %1, изменить %2, без изменений %3\n"
+                   "Блюда: добавить %4, изменить %5, без изменений %6")
+        .arg(addedCategories.size()).arg(updatedCategories.size()).arg(unchangedCategories)
+        .arg(addedMeals.size()).arg(updatedMeals.size()).arg(unchangedMeals);
+}
+
+MenuImportPlan MenuImport::plan(const QJsonObject &root,
+                                const QList<Category> &categories,
+                                const QList<Meal> &meals)
+{
+    MenuImportPlan plan;
+    StringPool &strings = StringPool::global();
+
+    QHash<int, const Category *> categoriesById;
+    QHash<QString, const Category *> categoriesByName;
+    categoriesById.reserve(categories.size());
+    categoriesByName.reserve(categories.size());
+    for (const Category &category : categories) {
+        categoriesById.insert(category.getId(), &category);
+        categoriesByName.insert(nameKey(category.getName()), &category);
+    }
+
+    // Категории, на которые смогут ссылаться блюда после импорта: по id и по названию.
+    // Новая категория без id получает временный отрицательный id, настоящий назначается при применении
+    QSet<int> knownCategoryIds(categoriesById.keyBegin(), categoriesById.keyEnd());
+    QHash<QString, int> categoryIdsByName;
+    categoryIdsByName.reserve(categories.size());
+    for (const Category &category : categories) {
+        categoryIdsByName.insert(nameKey(category.getName()), category.getId());
+    }
+    int provisionalCategoryId = 0;
+    QSet<int> seenCategoryIds;
+    QSet<QString> seenCategoryNames;
+
+    const QJsonArray categoriesArray = root["categories"].toArray();
+    for (qsizetype i = 0; i < categoriesArray.size(); ++i) {
+        const QJsonObject catObj = categoriesArray[i].toObject();
+        const int id = catObj["id"].toInt();
+        const QString name = strings.intern(catObj["name"].toString().trimmed());
+        const QString where = QString("Категория #%1").arg(i + 1);
+
+        if (name.isEmpty()) {
+            plan.errors.append(where + ": пустое название");
+            continue;
+        }
+        if ((id > 0 && seenCategoryIds.contains(id)) || seenCategoryNames.contains(nameKey(name))) {
+            plan.errors.append(where + QString(": повторяется в файле (%1)").arg(name));
+            continue;
+        }
+        // С id сопоставление идет по id, но название не должно совпасть с другой категорией
+        const Category *sameName = categoriesByName.value(nameKey(name));
+        if (id > 0 && sameName && sameName->getId() != id) {
+            plan.errors.append(where + QString(": название %1 уже у категории %2").arg(name).arg(sameName->getId()));
+            continue;
+        }
+        if (id > 0) {
+            seenCategoryIds.insert(id);
+        }
+        seenCategoryNames.insert(nameKey(name));
+
+        const Category *existing = id > 0 ? categoriesById.value(id) : categoriesByName.value(nameKey(name));
+        if (!existing) {
+            const int newId = id > 0 ? id : --provisionalCategoryId;
+            plan.addedCategories.append(Category(newId, name));
+            knownCategoryIds.insert(newId);
+            categoryIdsByName.insert(nameKey(name), newId);
+            continue;
+        }
+        categoryIdsByName.insert(nameKey(name), existing->getId());
+        if (!StringPool::equal(existing->getName(), name)) {
+            plan.updatedCategories.append(Category(existing->getId(), name));
+        } else {
+            ++plan.unchangedCategories;
+        }
+    }
+
+    QHash<int, const Meal *> mealsById;
+    QHash<QString, const Meal *> mealsByName;
+    mealsById.reserve(meals.size());
+    mealsByName.reserve(meals.size());
+    for (const Meal &meal : meals) {
+        mealsById.insert(meal.getId(), &meal);
+        mealsByName.insert(nameKey(meal.getName()), &meal);
+    }
+
+    QSet<int> seenMealIds;
+    QSet<QString> seenMealNames;
+
+    const QJsonArray mealsArray = root["meals"].toArray();
+    for (qsizetype i = 0; i < mealsArray.size(); ++i) {
+        const QJsonObject mealObj = mealsArray[i].toObject();
+        const int id = mealObj["id"].toInt();
+        const QString name = strings.intern(mealObj["name"].toString().trimmed());
+        const Money price = Money::fromJson(mealObj, "priceKopecks", "price");
+        // Категорию без id (в том числе новую) блюдо указывает названием в поле category
+        int categoryId = mealObj["categoryId"].toInt();
+        QString categoryRef = QString::number(categoryId);
+        if (categoryId <= 0) {
+            categoryRef = mealObj["category"].toString().trimmed();
+            categoryId = categoryIdsByName.value(nameKey(categoryRef), 0);
+        }
+        const QString where = QString("Блюдо #%1 (%2)").arg(i + 1).arg(name);
+
+        QStringList problems;
+        if (name.isEmpty()) {
+            problems.append("пустое название");
+        }
+        if (price.isNegative()) {
+            problems.append("отрицательная цена");
+        }
+        if (categoryRef.isEmpty()) {
+            problems.append("не указана категория");
+        } else if (!knownCategoryIds.contains(categoryId)) {
+            problems.append(QString("неизвестная категория %1").arg(categoryRef));
+        }
+        const Meal *sameName = name.isEmpty() ? nullptr : mealsByName.value(nameKey(name));
+        if (id > 0 && sameName && sameName->getId() != id) {
+            problems.append(QString("название уже у блюда %1").arg(sameName->getId()));
+        }
+        if ((id > 0 && seenMealIds.contains(id)) || (!name.isEmpty() && seenMealNames.contains(nameKey(name)))) {
+            problems.append("повторяется в файле");
+        }
+        if (!problems.isEmpty()) {
+            plan.errors.append(where + ": " + problems.join(", "));
+            continue;
+        }
+        if (id > 0) {
+            seenMealIds.insert(id);
+        }
+        seenMealNames.insert(nameKey(name));
+
+        const Meal *existing = id > 0 ? mealsById.value(id) : mealsByName.value(nameKey(name));
+        // Файлы поставщиков обычно без картинок - тогда сохраняется текущая
+        const QString imagePath = mealObj.contains("imagePath") ? strings.intern(mealObj["imagePath"].toString())
+                                  : existing ? existing->getImagePath() : QString();
+        Meal meal(existing ? existing->getId() : id, name, price, categoryId, imagePath);
+
+        if (!existing) {
+            plan.addedMeals.append(meal);
+        } else if (!sameMeal(*existing, meal)) {
+            plan.updatedMeals.append(meal);
+        } else {
+            ++plan.unchangedMeals;
+        }
+    }
+
+    return plan;
+}
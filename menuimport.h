@@ -0,0 +1,44 @@
+#ifndef MENUIMPORT_H
+#define MENUIMPORT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+#include "meal.h"
+#include "category.h"
+
+// План импорта меню (сухой прогон): что будет добавлено, изменено и что совпадает
+// с текущим меню. Строится за один проход по хэш-индексам id и имен; применяется
+// DataManager::applyMenuImport одним сохранением.
+struct MenuImportPlan
+{
+    QList<Category> addedCategories;   // id < 0 - временный, настоящий назначается при применении
+    QList<Category> updatedCategories;
+    int unchangedCategories = 0;
+    QList<Meal> addedMeals;            // id <= 0 - id назначается при применении;
+                                       // categoryId < 0 - ссылка на новую категорию из addedCategories
+    QList<Meal> updatedMeals;
+    int unchangedMeals = 0;
+    QStringList errors;                // непустой список - план применять нельзя
+    quint64 mealsVersion = 0;          // версия меню, относительно которой построен план
+
+    bool isValid() const { return errors.isEmpty(); }
+    bool hasChanges() const;
+    // Текст для подтверждения администратором
+    QString summary() const;
+};
+
+class MenuImport
+{
+public:
+    // Сопоставление: сначала по id, затем (если id не задан) по имени без учета регистра.
+    // Запись с id не может взять название другой существующей записи.
+    // Категория блюда - categoryId существующей или импортируемой категории либо ее название
+    // в поле category (так указываются новые категории без id).
+    static MenuImportPlan plan(const QJsonObject &root,
+                               const QList<Category> &categories,
+                               const QList<Meal> &meals);
+};
+
+#endif // MENUIMPORT_H
@@ -0,0 +1,25 @@
+#include "money.h"
+#include <QJsonObject>
+#include <QtMath>
+
+Money Money::fromRubles(double rubles)
+{
+    return Money(qRound64(rubles * 100.0));
+}
+
+Money Money::fromJson(const QJsonObject &obj, const QString &kopecksKey, const QString &legacyRublesKey)
+{
+    if (obj.contains(kopecksKey)) {
+        return Money(obj[kopecksKey].toInteger());
+    }
+    return fromRubles(obj[legacyRublesKey].toDouble());
+}
+
+QString Money::toString() const
+{
+    const qint64 absolute = m_kopecks < 0 ? -m_kopecks : m_kopecks;
+    return QString("%1%2.%3")
+        .arg(m_kopecks < 0 ? "-" : "")
+        .arg(absolute / 100)
+        .arg(absolute % 100, 2, 10, QChar('0'));
+}
@@ -0,0 +1,50 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <QString>
+#include <QMetaType>
+
+class QJsonObject;
+
+// Денежная сумма в копейках. Целочисленное хранение дает точные суммы,
+// не зависящие от порядка сложения.
+class Money
+{
+public:
+    constexpr Money() : m_kopecks(0) {}
+    
+    static constexpr Money fromKopecks(qint64 kopecks) { return Money(kopecks); }
+    static Money fromRubles(double rubles);
+    
+    // Читает сумму из kopecksKey; старые файлы хранили рубли в double под legacyRublesKey
+    static Money fromJson(const QJsonObject &obj, const QString &kopecksKey, const QString &legacyRublesKey);
+    
+    constexpr qint64 kopecks() const { return m_kopecks; }
+    double toRubles() const { return m_kopecks / 100.0; }
+    QString toString() const; // "123.45"
+    
+    constexpr bool isNegative() const { return m_kopecks < 0; }
+    
+    Money &operator+=(Money other) { m_kopecks += other.m_kopecks; return *this; }
+    Money &operator-=(Money other) { m_kopecks -= other.m_kopecks; return *this; }
+    
+    friend constexpr Money operator+(Money a, Money b) { return Money(a.m_kopecks + b.m_kopecks); }
+    friend constexpr Money operator-(Money a, Money b) { return Money(a.m_kopecks - b.m_kopecks); }
+    friend constexpr Money operator*(Money a, qint64 factor) { return Money(a.m_kopecks * factor); }
+    
+    friend constexpr bool operator==(Money a, Money b) { return a.m_kopecks == b.m_kopecks; }
+    friend constexpr bool operator!=(Money a, Money b) { return a.m_kopecks != b.m_kopecks; }
+    friend constexpr bool operator<(Money a, Money b) { return a.m_kopecks < b.m_kopecks; }
+    friend constexpr bool operator>(Money a, Money b) { return a.m_kopecks > b.m_kopecks; }
+    friend constexpr bool operator<=(Money a, Money b) { return a.m_kopecks <= b.m_kopecks; }
+    friend constexpr bool operator>=(Money a, Money b) { return a.m_kopecks >= b.m_kopecks; }
+    
+private:
+    constexpr explicit Money(qint64 kopecks) : m_kopecks(kopecks) {}
+    
+    qint64 m_kopecks;
+};
+
+Q_DECLARE_METATYPE(Money)
+
+#endif // MONEY_H
@@ -3,18 +3,29 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 
-Order::Order(int id, int userId, const QDate &date, const QList<QPair<int, int>> &meals)
-    : m_id(id), m_userId(userId), m_date(date), m_meals(meals), m_totalPrice(0.0)
+Order::Order(int id, int userId, const QDate &date, OrderLines meals)
+    : m_id(id), m_userId(userId), m_date(date), m_meals(std::move(meals)), m_totalPrice()
+{
+}
+
+Order::Order(int id, int userId, const QDate &date, const QList<OrderLine> &meals)
+    : m_id(id), m_userId(userId), m_date(date), m_meals(meals.cbegin(), meals.cend()), m_totalPrice()
 {
 }
 
 QString Order::toJson() const
+{
+    QJsonDocument doc(toJsonObject());
+    return doc.toJson(QJsonDocument::Compact);
+}
+
+QJsonObject Order::toJsonObject() const
 {
     QJsonObject obj;
     obj["id"] = m_id;
     obj["userId"] = m_userId;
     obj["date"] = m_date.toString(Qt::ISODate);
-    obj["totalPrice"] = m_totalPrice;
+    obj["totalKopecks"] = m_totalPrice.kopecks();
     
     QJsonArray mealsArray;
     for (const auto &meal : m_meals) {
@@ -24,19 +35,20 @@ QString Order::toJson() const
         mealsArray.append(mealObj);
     }
     obj["meals"] = mealsArray;
-    
-    QJsonDocument doc(obj);
-    return doc.toJson(QJsonDocument::Compact);
+    return obj;
 }
 
 Order Order::fromJson(const QString &json)
 {
     QJsonDocument doc = QJsonDocument::fromJson(json.toUtf8());
-    QJsonObject obj = doc.object();
-    
+    return fromJsonObject(doc.object());
+}
+
+Order Order::fromJsonObject(const QJsonObject &obj)
+{
     QDate date = QDate::fromString(obj["date"].toString(), Qt::ISODate);
     
-    QList<QPair<int, int>> meals;
+    OrderLines meals;
     QJsonArray mealsArray = obj["meals"].toArray();
     for (const auto &value : mealsArray) {
         QJsonObject mealObj = value.toObject();
@@ -47,24 +59,9 @@ Order Order::fromJson(const QString &json)
         obj["id"].toInt(),
         obj["userId"].toInt(),
         date,
-        meals
+        std::move(meals)
     );
-    order.setTotalPrice(obj["totalPrice"].toDouble());
+    order.setTotalPrice(Money::fromJson(obj, "totalKopecks", "totalPrice"));
     
     return order;
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
@@ -5,30 +5,41 @@
 #include <QDate>
 #include <QList>
 #include <QPair>
+#include <QVarLengthArray>
 #include <QtCore>
+#include <utility>
+#include "money.h"
+
+using OrderLine = QPair<int, int>; // mealId, quantity
+
+// Обычно в заказе 1-4 позиции: они хранятся прямо в Order, без отдельного выделения памяти
+using OrderLines = QVarLengthArray<OrderLine, 4>;
 
 class Order
 {
 public:
-    Order(int id, int userId, const QDate &date, const QList<QPair<int, int>> &meals); // mealId, quantity
+    Order(int id, int userId, const QDate &date, OrderLines meals);
+    Order(int id, int userId, const QDate &date, const QList<OrderLine> &meals);
     
     int getId() const { return m_id; }
     int getUserId() const { return m_userId; }
     QDate getDate() const { return m_date; }
-    QList<QPair<int, int>> getMeals() const { return m_meals; }
-    double getTotalPrice() const { return m_totalPrice; }
+    const OrderLines &getMeals() const { return m_meals; }
+    Money getTotalPrice() const { return m_totalPrice; }
     
-    void setTotalPrice(double price) { m_totalPrice = price; }
+    void setTotalPrice(Money price) { m_totalPrice = price; }
     
     QString toJson() const;
+    QJsonObject toJsonObject() const;
     static Order fromJson(const QString &json);
+    static Order fromJsonObject(const QJsonObject &obj);
     
 private:
     int m_id;
     int m_userId;
     QDate m_date;
-    QList<QPair<int, int>> m_meals;
-    double m_totalPrice;
+    OrderLines m_meals;
+    Money m_totalPrice;
 };
 
 #endif // ORDER_H
@@ -0,0 +1,70 @@
+#include "ordercolumns.h"
+
+OrderColumns::OrderColumns()
+{
+    m_lineOffsets.append(0);
+}
+
+OrderColumns OrderColumns::fromOrders(const QList<Order> &orders)
+{
+    qsizetype lineCount = 0;
+    for (const Order &order : orders) {
+        lineCount += order.getMeals().size();
+    }
+    
+    OrderColumns columns;
+    columns.reserve(orders.size(), lineCount);
+    for (const Order &order : orders) {
+        columns.append(order);
+    }
+    return columns;
+}
+
+void OrderColumns::clear()
+{
+    m_days.clear();
+    m_totals.clear();
+    m_userIds.clear();
+    m_lineOffsets.clear();
+    m_lineOffsets.append(0);
+    m_lineMealIds.clear();
+    m_lineQuantities.clear();
+}
+
+void OrderColumns::reserve(qsizetype orderCount, qsizetype lineCount)
+{
+    m_days.reserve(orderCount);
+    m_totals.reserve(orderCount);
+    m_userIds.reserve(orderCount);
+    m_lineOffsets.reserve(orderCount + 1);
+    m_lineMealIds.reserve(lineCount);
+    m_lineQuantities.reserve(lineCount);
+}
+
+void OrderColumns::append(const Order &order)
+{
+    const QDate date = order.getDate();
+    m_days.append(date.isValid() ? static_cast<qint32>(date.toJulianDay()) : InvalidDay);
+    m_totals.append(order.getTotalPrice().kopecks());
+    m_userIds.append(order.getUserId());
+    
+    for (const OrderLine &line : order.getMeals()) {
+        m_lineMealIds.append(line.first);
+        m_lineQuantities.append(line.second);
+    }
+    m_lineOffsets.append(static_cast<qint32>(m_lineMealIds.size()));
+}
+
+OrderColumnsView OrderColumns::view() const
+{
+    OrderColumnsView view;
+    view.days = m_days.constData();
+    view.totals = m_totals.constData();
+    view.userIds = m_userIds.constData();
+    view.size = m_days.size();
+    view.lineOffsets = m_lineOffsets.constData();
+    view.lineMealIds = m_lineMealIds.constData();
+    view.lineQuantities = m_lineQuantities.constData();
+    view.lineCount = m_lineMealIds.size();
+    return view;
+}
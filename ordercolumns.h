@@ -0,0 +1,60 @@
+#ifndef ORDERCOLUMNS_H
+#define ORDERCOLUMNS_H
+
+#include <QList>
+#include <QVector>
+#include "order.h"
+
+// Указатели на колонки без владения данными: так отчеты одинаково читают и
+// OrderColumns в памяти, и архивные сегменты, отображенные с диска (OrderSegment)
+struct OrderColumnsView
+{
+    const qint32 *days = nullptr;
+    const qint64 *totals = nullptr;
+    const qint32 *userIds = nullptr;
+    qsizetype size = 0;
+    const qint32 *lineOffsets = nullptr; // size + 1 элементов
+    const qint32 *lineMealIds = nullptr;
+    const qint32 *lineQuantities = nullptr;
+    qsizetype lineCount = 0;
+};
+
+// Колоночное представление истории заказов для отчетов.
+// Каждая колонка - плоский массив, i-й элемент относится к i-му заказу;
+// позиции заказа i лежат в line* колонках в диапазоне [lineOffsets[i], lineOffsets[i + 1]).
+class OrderColumns
+{
+public:
+    // Номер дня для заказа с некорректной датой
+    static constexpr qint32 InvalidDay = 0;
+    
+    OrderColumns();
+    
+    static OrderColumns fromOrders(const QList<Order> &orders);
+    
+    void clear();
+    void reserve(qsizetype orderCount, qsizetype lineCount);
+    void append(const Order &order);
+    
+    qsizetype size() const { return m_days.size(); }
+    qsizetype lineCount() const { return m_lineMealIds.size(); }
+    
+    const QVector<qint32> &days() const { return m_days; }           // QDate::toJulianDay()
+    const QVector<qint64> &totals() const { return m_totals; }       // сумма заказа в копейках
+    const QVector<qint32> &userIds() const { return m_userIds; }
+    const QVector<qint32> &lineOffsets() const { return m_lineOffsets; } // size() + 1 элементов
+    const QVector<qint32> &lineMealIds() const { return m_lineMealIds; }
+    const QVector<qint32> &lineQuantities() const { return m_lineQuantities; }
+    
+    OrderColumnsView view() const;
+    
+private:
+    QVector<qint32> m_days;
+    QVector<qint64> m_totals;
+    QVector<qint32> m_userIds;
+    QVector<qint32> m_lineOffsets;
+    QVector<qint32> m_lineMealIds;
+    QVector<qint32> m_lineQuantities;
+};
+
+#endif // ORDERCOLUMNS_H
@@ -0,0 +1,188 @@
+#include "orderexporter.h"
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDate>
+
+namespace {
+
+// Поле CSV по RFC 4180: кавычки, если внутри есть разделитель, кавычка или перевод строки
+QByteArray csvField(const QString &value)
+{
+    QByteArray field = value.toUtf8();
+    if (field.contains(',') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        field.replace("\"", "\"\"");
+        field = '"' + field + '"';
+    }
+    return field;
+}
+
+// Сдвигает многострочный JSON на indent пробелов, чтобы вложить его в массив
+QByteArray indented(const QByteArray &json, int indent)
+{
+    const QByteArray prefix(indent, ' ');
+    QByteArray result;
+    result.reserve(json.size() + json.count('\n') * indent);
+    for (const QByteArray &line : json.split('\n')) {
+        if (!line.isEmpty()) {
+            result += prefix + line + '\n';
+        }
+    }
+    result.chop(1);
+    return result;
+}
+
+}
+
+OrderExporter::OrderExporter(const QList<User> &users, const QList<Meal> &meals, const QList<Category> &categories)
+{
+    // Копии строк разделяют данные с пользователями и блюдами, пул здесь не нужен
+    m_usernames.reserve(users.size());
+    for (const User &user : users) {
+        m_usernames.insert(user.getId(), user.getUsername());
+    }
+
+    QHash<int, QJsonObject> categoryObjects;
+    categoryObjects.reserve(categories.size());
+    for (const Category &category : categories) {
+        QJsonObject categoryObj;
+        categoryObj["id"] = category.getId();
+        categoryObj["name"] = category.getName();
+        categoryObjects.insert(category.getId(), categoryObj);
+    }
+
+    m_mealNames.reserve(meals.size());
+    m_mealObjects.reserve(meals.size());
+    for (const Meal &meal : meals) {
+        m_mealNames.insert(meal.getId(), meal.getName());
+
+        QJsonObject mealObj;
+        mealObj["id"] = meal.getId();
+        mealObj["name"] = meal.getName();
+        mealObj["price"] = meal.getPrice().toRubles();
+        auto category = categoryObjects.constFind(meal.getCategoryId());
+        if (category != categoryObjects.cend()) {
+            mealObj["category"] = *category;
+        }
+        m_mealObjects.insert(meal.getId(), mealObj);
+    }
+}
+
+OrderExporter::Format OrderExporter::formatForFile(const QString &filename)
+{
+    if (filename.endsWith(".csv", Qt::CaseInsensitive)) {
+        return Format::Csv;
+    }
+    if (filename.endsWith(".ndjson", Qt::CaseInsensitive) || filename.endsWith(".jsonl", Qt::CaseInsensitive)) {
+        return Format::NdJson;
+    }
+    return Format::Json;
+}
+
+bool OrderExporter::exportOrders(const QList<Order> &orders, QIODevice *device, Format format,
+                                 const ProgressCallback &progress, QString *errorMessage) const
+{
+    auto write = [device](const QByteArray &data) {
+        return device->write(data) == data.size();
+    };
+    auto fail = [device, errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message.isEmpty() ? device->errorString() : message;
+        }
+        return false;
+    };
+
+    bool ok = true;
+    if (format == Format::Csv) {
+        ok = write("id,date,userId,username,total,meals\n");
+    } else if (format == Format::Json) {
+        // Ключи в том же порядке, что писал QJsonDocument (по алфавиту): totalOrders - после заказов
+        ok = write("{\n    \"exportDate\": \"" + QDate::currentDate().toString(Qt::ISODate).toUtf8() + "\",\n"
+                   "    \"orders\": [\n");
+    }
+    if (!ok) {
+        return fail(QString());
+    }
+
+    const qsizetype total = orders.size();
+    for (qsizetype i = 0; i < total; ++i) {
+        const Order &order = orders[i];
+        QByteArray record;
+        switch (format) {
+        case Format::Csv:
+            record = orderToCsv(order);
+            break;
+        case Format::NdJson:
+            record = QJsonDocument(orderToJson(order)).toJson(QJsonDocument::Compact) + '\n';
+            break;
+        case Format::Json:
+            record = indented(QJsonDocument(orderToJson(order)).toJson(QJsonDocument::Indented), 8);
+            record += i + 1 < total ? ",\n" : "\n";
+            break;
+        }
+        if (!write(record)) {
+            return fail(QString());
+        }
+
+        if (progress && (i + 1) % ProgressStep == 0 && !progress(i + 1, total)) {
+            return fail("Экспорт отменен");
+        }
+    }
+
+    if (format == Format::Json && !write("    ],\n    \"totalOrders\": " + QByteArray::number(total) + "\n}\n")) {
+        return fail(QString());
+    }
+    if (progress) {
+        progress(total, total);
+    }
+    return true;
+}
+
+QJsonObject OrderExporter::orderToJson(const Order &order) const
+{
+    QJsonObject orderObj;
+    orderObj["id"] = order.getId();
+    orderObj["userId"] = order.getUserId();
+    orderObj["date"] = order.getDate().toString(Qt::ISODate);
+    orderObj["totalPrice"] = order.getTotalPrice().toRubles();
+
+    auto user = m_usernames.constFind(order.getUserId());
+    if (user != m_usernames.cend()) {
+        QJsonObject userObj;
+        userObj["id"] = order.getUserId();
+        userObj["username"] = *user;
+        orderObj["user"] = userObj;
+    }
+
+    QJsonArray mealsArray;
+    for (const auto &mealPair : order.getMeals()) {
+        auto meal = m_mealObjects.constFind(mealPair.first);
+        if (meal == m_mealObjects.cend()) {
+            continue;
+        }
+        QJsonObject mealObj = *meal;
+        mealObj["quantity"] = mealPair.second;
+        mealsArray.append(mealObj);
+    }
+    orderObj["meals"] = mealsArray;
+    return orderObj;
+}
+
+QByteArray OrderExporter::orderToCsv(const Order &order) const
+{
+    QStringList meals;
+    for (const auto &mealPair : order.getMeals()) {
+        auto meal = m_mealNames.constFind(mealPair.first);
+        const QString name = meal != m_mealNames.cend() ? *meal : QString("#%1").arg(mealPair.first);
+        meals.append(QString("%1 x%2").arg(name).arg(mealPair.second));
+    }
+
+    QByteArray row;
+    row += QByteArray::number(order.getId()) + ',';
+    row += order.getDate().toString(Qt::ISODate).toUtf8() + ',';
+    row += QByteArray::number(order.getUserId()) + ',';
+    row += csvField(m_usernames.value(order.getUserId())) + ',';
+    row += order.getTotalPrice().toString().toUtf8() + ',';
+    row += csvField(meals.join("; ")) + '\n';
+    return row;
+}
@@ -0,0 +1,50 @@
+#ifndef ORDEREXPORTER_H
+#define ORDEREXPORTER_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QJsonObject>
+#include <functional>
+#include "order.h"
+#include "user.h"
+#include "meal.h"
+#include "category.h"
+
+class QIODevice;
+
+// Потоковый экспорт заказов: записи пишутся в QIODevice по одной, без сборки
+// всего документа в памяти. Пользователи, блюда и категории ищутся по хэш-индексам,
+// построенным один раз в конструкторе. Класс не обращается к DataManager и хранит
+// свои копии справочников, поэтому экспорт можно выполнять в рабочем потоке.
+class OrderExporter
+{
+public:
+    enum class Format { Csv, NdJson, Json };
+
+    // Вызывается периодически; вернуть false - прервать экспорт
+    using ProgressCallback = std::function<bool(qsizetype done, qsizetype total)>;
+
+    OrderExporter(const QList<User> &users, const QList<Meal> &meals, const QList<Category> &categories);
+
+    // Формат по расширению файла (.csv, .ndjson/.jsonl, иначе JSON)
+    static Format formatForFile(const QString &filename);
+
+    bool exportOrders(const QList<Order> &orders, QIODevice *device, Format format,
+                      const ProgressCallback &progress = ProgressCallback(),
+                      QString *errorMessage = nullptr) const;
+
+private:
+    static constexpr qsizetype ProgressStep = 1024;
+
+    QJsonObject orderToJson(const Order &order) const;
+    QByteArray orderToCsv(const Order &order) const;
+
+    QHash<int, QString> m_usernames;
+    QHash<int, QString> m_mealNames;
+    // Описание блюда с категорией собирается один раз; в заказ копируется с количеством
+    QHash<int, QJsonObject> m_mealObjects;
+};
+
+#endif // ORDEREXPORTER_H
@@ -6,11 +6,10 @@ OrderObserver::OrderObserver(QObject *parent)
 {
 }
 
-void OrderObserver::notifyOrderPlaced(Order *order, User *user, double totalPrice)
+void OrderObserver::notifyOrderPlaced(const User &user)
 {
-    if (user && user->deductBalance(totalPrice)) {
-        emit balanceUpdated(user->getId(), user->getBalance());
-    }
+    // Баланс уже списан в DataManager::placeOrder
+    emit balanceUpdated(user.getId(), user.getBalance());
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include "order.h"
+#include "money.h"
 
 class User;
 
@@ -13,10 +14,10 @@ class OrderObserver : public QObject
 public:
     OrderObserver(QObject *parent = nullptr);
     
-    void notifyOrderPlaced(Order *order, User *user, double totalPrice);
+    void notifyOrderPlaced(const User &user);
 
 signals:
-    void balanceUpdated(int userId, double newBalance);
+    void balanceUpdated(int userId, Money newBalance);
 };
 
 #endif // ORDEROBSERVER_H
@@ -0,0 +1,427 @@
+#include "orderpartitions.h"
+#include "snapshotstore.h"
+#include "ordersegment.h"
+#include "scratcharena.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Количества порций по id блюда считаются в плотном массиве только для id меньше этого
+// значения; большие (например, из импортированного файла) идут сразу в хэш сводки
+constexpr int MaxDenseMealId = 1 << 16;
+
+}
+
+OrderPartitionSummary OrderPartitionSummary::fromOrders(int month, const QList<Order> &orders)
+{
+    OrderPartitionSummary summary;
+    summary.month = month;
+    summary.orderCount = orders.size();
+
+    // Промежуточные данные лежат на арене в плотных массивах; узлы QHash и QMap
+    // создаются по разу на итоговый ключ, а не на каждый заказ
+    ScratchArena arena;
+    auto mealQuantities = arena.vector<qint64>(); // mealId -> количество порций
+    auto userIds = arena.vector<int>();
+    auto days = arena.vector<std::pair<qint32, qint64>>(); // день заказа и его сумма
+    userIds.reserve(orders.size());
+    days.reserve(orders.size());
+    for (const Order &order : orders) {
+        summary.revenueKopecks += order.getTotalPrice().kopecks();
+        summary.maxOrderId = qMax(summary.maxOrderId, order.getId());
+        for (const OrderLine &line : order.getMeals()) {
+            if (line.first < 0 || line.first >= MaxDenseMealId) {
+                summary.mealQuantities[line.first] += line.second;
+                continue;
+            }
+            if (std::size_t(line.first) >= mealQuantities.size()) {
+                mealQuantities.resize(std::size_t(line.first) + 1, 0);
+            }
+            mealQuantities[line.first] += line.second;
+        }
+        userIds.push_back(order.getUserId());
+        const qint32 day = order.getDate().isValid() ? qint32(order.getDate().toJulianDay()) : 0;
+        days.emplace_back(day, order.getTotalPrice().kopecks());
+    }
+
+    for (std::size_t mealId = 0; mealId < mealQuantities.size(); ++mealId) {
+        if (mealQuantities[mealId] != 0) {
+            summary.mealQuantities.insert(int(mealId), mealQuantities[mealId]);
+        }
+    }
+
+    std::sort(userIds.begin(), userIds.end());
+    userIds.erase(std::unique(userIds.begin(), userIds.end()), userIds.end());
+    summary.userIds = QList<int>(userIds.cbegin(), userIds.cend());
+
+    // Дни вставляются по возрастанию, подсказка cend() избавляет от поиска по дереву
+    std::sort(days.begin(), days.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (auto it = days.cbegin(); it != days.cend();) {
+        const qint32 day = it->first;
+        qint32 count = 0;
+        qint64 revenue = 0;
+        for (; it != days.cend() && it->first == day; ++it) {
+            ++count;
+            revenue += it->second;
+        }
+        summary.dailyCounts.insert(summary.dailyCounts.cend(), day, count);
+        summary.dailyRevenue.insert(summary.dailyRevenue.cend(), day, revenue);
+    }
+    return summary;
+}
+
+QJsonObject OrderPartitionSummary::toJson() const
+{
+    QJsonObject obj;
+    obj["month"] = month;
+    obj["orders"] = orderCount;
+    obj["revenueKopecks"] = revenueKopecks;
+    obj["maxOrderId"] = maxOrderId;
+
+    QJsonObject meals;
+    for (auto it = mealQuantities.cbegin(); it != mealQuantities.cend(); ++it) {
+        meals[QString::number(it.key())] = it.value();
+    }
+    obj["meals"] = meals;
+
+    QJsonArray users;
+    for (int userId : userIds) {
+        users.append(userId);
+    }
+    obj["users"] = users;
+
+    QJsonArray days;
+    for (auto it = dailyCounts.cbegin(); it != dailyCounts.cend(); ++it) {
+        days.append(QJsonArray{ it.key(), it.value(), dailyRevenue.value(it.key()) });
+    }
+    obj["days"] = days;
+    obj["archived"] = archived;
+    return obj;
+}
+
+OrderPartitionSummary OrderPartitionSummary::fromJson(const QJsonObject &obj)
+{
+    OrderPartitionSummary summary;
+    summary.month = obj["month"].toInt();
+    summary.orderCount = obj["orders"].toInt();
+    summary.revenueKopecks = obj["revenueKopecks"].toInteger();
+    summary.maxOrderId = obj["maxOrderId"].toInt();
+
+    const QJsonObject meals = obj["meals"].toObject();
+    for (auto it = meals.constBegin(); it != meals.constEnd(); ++it) {
+        summary.mealQuantities.insert(it.key().toInt(), it.value().toInteger());
+    }
+    for (const auto &value : obj["users"].toArray()) {
+        summary.userIds.append(value.toInt());
+    }
+    for (const auto &value : obj["days"].toArray()) {
+        const QJsonArray day = value.toArray();
+        summary.dailyCounts.insert(day[0].toInt(), day[1].toInt());
+        summary.dailyRevenue.insert(day[0].toInt(), day[2].toInteger());
+    }
+    summary.archived = obj["archived"].toBool();
+    return summary;
+}
+
+OrderPartitionStore::OrderPartitionStore()
+{
+}
+
+void OrderPartitionStore::setDirectory(const QString &directory)
+{
+    m_directory = directory;
+    QMutexLocker locker(&m_segmentsMutex);
+    m_segments.clear();
+}
+
+int OrderPartitionStore::monthKey(const QDate &date)
+{
+    return date.year() * 100 + date.month();
+}
+
+QDate OrderPartitionStore::monthStart(int month)
+{
+    return QDate(month / 100, month % 100, 1);
+}
+
+int OrderPartitionStore::nextMonth(int month)
+{
+    return month % 100 == 12 ? (month / 100 + 1) * 100 + 1 : month + 1;
+}
+
+QString OrderPartitionStore::partitionPath(int month) const
+{
+    return QDir(m_directory).filePath(monthStart(month).toString("yyyy-MM") + ".json");
+}
+
+QString OrderPartitionStore::archivePath(int month) const
+{
+    return QDir(m_directory).filePath("archive/" + monthStart(month).toString("yyyy-MM") + ".seg");
+}
+
+bool OrderPartitionStore::isArchived(int month) const
+{
+    auto it = m_summaries.constFind(month);
+    return it != m_summaries.cend() && it->archived;
+}
+
+bool OrderPartitionStore::loadIndex()
+{
+    m_summaries.clear();
+    m_unreadableMonths.clear();
+    SnapshotStore index(QDir(m_directory).filePath("index.json"), 1);
+    if (!index.hasAnyGeneration()) {
+        return rebuildIndex();
+    }
+
+    QJsonObject root;
+    if (!index.load(&root)) {
+        qWarning() << "Orders: partition index is damaged, rebuilding it from" << m_directory;
+        return rebuildIndex();
+    }
+    for (const auto &value : root["partitions"].toArray()) {
+        OrderPartitionSummary summary = OrderPartitionSummary::fromJson(value.toObject());
+        m_summaries.insert(summary.month, summary);
+    }
+    return true;
+}
+
+bool OrderPartitionStore::rebuildIndex()
+{
+    m_summaries.clear();
+    m_unreadableMonths.clear();
+
+    // Рабочие файлы: YYYY-MM.json и их предыдущие поколения YYYY-MM.json.N
+    const QRegularExpression partitionName("^(\\d{4})-(\\d{2})\\.json(\\.\\d+)?$");
+    const QRegularExpression segmentName("^(\\d{4})-(\\d{2})\\.seg$");
+    auto monthOf = [](const QRegularExpressionMatch &match) {
+        return match.captured(1).toInt() * 100 + match.captured(2).toInt();
+    };
+    QSet<int> partitions;
+    for (const QString &name : QDir(m_directory).entryList(QDir::Files)) {
+        const QRegularExpressionMatch match = partitionName.match(name);
+        if (match.hasMatch()) {
+            partitions.insert(monthOf(match));
+        }
+    }
+    QSet<int> segments;
+    for (const QString &name : QDir(QDir(m_directory).filePath("archive")).entryList(QDir::Files)) {
+        const QRegularExpressionMatch match = segmentName.match(name);
+        if (match.hasMatch()) {
+            segments.insert(monthOf(match));
+        }
+    }
+
+    for (int month : partitions) {
+        QList<Order> orders;
+        if (readPartition(month, &orders)) {
+            m_summaries.insert(month, OrderPartitionSummary::fromOrders(month, orders));
+        } else {
+            m_unreadableMonths.insert(month);
+        }
+    }
+    // Если есть и рабочий файл, и сегмент (сбой во время архивации), верен рабочий файл:
+    // сегмент записан из него, а индекс на сегмент переключиться не успел
+    for (int month : segments) {
+        if (partitions.contains(month)) {
+            continue;
+        }
+        if (const std::shared_ptr<const OrderSegment> archived = segment(month)) {
+            OrderPartitionSummary summary = OrderPartitionSummary::fromOrders(month, archived->toOrders());
+            summary.archived = true;
+            m_summaries.insert(month, summary);
+        } else {
+            m_unreadableMonths.insert(month);
+        }
+    }
+
+    if (!m_unreadableMonths.isEmpty()) {
+        qWarning() << "Orders: index rebuilt without unreadable months" << m_unreadableMonths.values();
+        return false;
+    }
+    if (!m_summaries.isEmpty()) {
+        qInfo() << "Orders: index rebuilt for" << m_summaries.size() << "months";
+    }
+    return true;
+}
+
+bool OrderPartitionStore::readPartition(int month, QList<Order> *orders) const
+{
+    if (isArchived(month)) {
+        return readArchive(month, orders);
+    }
+
+    SnapshotStore partition(partitionPath(month), 1);
+    if (!partition.hasAnyGeneration()) {
+        return true;
+    }
+
+    QJsonObject root;
+    if (!partition.load(&root)) {
+        return false;
+    }
+    const QJsonArray ordersArray = root["orders"].toArray();
+    orders->reserve(orders->size() + ordersArray.size());
+    for (const auto &value : ordersArray) {
+        orders->append(Order::fromJsonObject(value.toObject()));
+    }
+    return true;
+}
+
+bool OrderPartitionStore::writePartition(int month, const QList<Order> &orders)
+{
+    if (!QDir().mkpath(m_directory)) {
+        return false;
+    }
+
+    QJsonArray ordersArray;
+    for (const Order &order : orders) {
+        ordersArray.append(order.toJsonObject());
+    }
+    QJsonObject root;
+    root["month"] = month;
+    root["orders"] = ordersArray;
+
+    SnapshotStore partition(partitionPath(month), 1);
+    QString error;
+    if (!partition.write(QJsonDocument(root).toJson(QJsonDocument::Compact), &error)) {
+        qWarning() << "Orders: failed to write" << partitionPath(month) << ":" << error;
+        return false;
+    }
+    m_summaries.insert(month, OrderPartitionSummary::fromOrders(month, orders));
+    return true;
+}
+
+bool OrderPartitionStore::writeIndex()
+{
+    if (!m_unreadableMonths.isEmpty()) {
+        qWarning() << "Orders: keeping the old index, months" << m_unreadableMonths.values() << "are unreadable";
+        return false;
+    }
+    if (!QDir().mkpath(m_directory)) {
+        return false;
+    }
+
+    QJsonArray partitions;
+    for (const OrderPartitionSummary &summary : m_summaries) {
+        partitions.append(summary.toJson());
+    }
+    QJsonObject root;
+    root["partitions"] = partitions;
+
+    SnapshotStore index(QDir(m_directory).filePath("index.json"), 1);
+    return index.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
+
+bool OrderPartitionStore::archivePartition(int month, QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+
+    if (isArchived(month)) {
+        return true;
+    }
+
+    QList<Order> orders;
+    if (!readPartition(month, &orders)) {
+        return fail("Файл заказов за месяц поврежден");
+    }
+
+    const QString path = archivePath(month);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return fail("Не удалось создать каталог архива");
+    }
+    QString error;
+    if (!OrderSegment::write(path, month, orders, &error)) {
+        return fail(error);
+    }
+
+    // Индекс переключается на сегмент до удаления рабочего файла:
+    // при сбое между шагами остается либо старое состояние, либо лишний файл
+    OrderPartitionSummary summary = OrderPartitionSummary::fromOrders(month, orders);
+    summary.archived = true;
+    const OrderPartitionSummary previous = m_summaries.value(month);
+    m_summaries.insert(month, summary);
+    if (!writeIndex()) {
+        m_summaries.insert(month, previous);
+        return fail("Не удалось обновить индекс заказов");
+    }
+
+    SnapshotStore partition(partitionPath(month), 1);
+    for (int generation = 0; generation <= partition.generations(); ++generation) {
+        QFile::remove(partition.generationPath(generation));
+    }
+    return true;
+}
+
+bool OrderPartitionStore::readArchive(int month, QList<Order> *orders) const
+{
+    const std::shared_ptr<const OrderSegment> archived = segment(month);
+    if (!archived) {
+        return false;
+    }
+    orders->append(archived->toOrders());
+    return true;
+}
+
+qint64 OrderPartitionStore::mappedSegmentBytes(int *segmentCount) const
+{
+    QMutexLocker locker(&m_segmentsMutex);
+    qint64 bytes = 0;
+    int count = 0;
+    for (const auto &segment : m_segments) {
+        if (segment) {
+            bytes += segment->mappedBytes();
+            ++count;
+        }
+    }
+    if (segmentCount) {
+        *segmentCount = count;
+    }
+    return bytes;
+}
+
+std::shared_ptr<const OrderSegment> OrderPartitionStore::segment(int month) const
+{
+    QMutexLocker locker(&m_segmentsMutex);
+    auto it = m_segments.constFind(month);
+    if (it != m_segments.cend()) {
+        return *it;
+    }
+
+    const QString path = archivePath(month);
+    auto opened = std::make_shared<OrderSegment>();
+    // Проверка суммы читает сегмент целиком, но только при первом обращении к месяцу
+    if (!opened->open(path) || !opened->verify()) {
+        return nullptr;
+    }
+    m_segments.insert(month, opened);
+    return opened;
+}
+
+OrderArchive OrderPartitionStore::archive() const
+{
+    OrderArchive result;
+    for (const OrderPartitionSummary &summary : m_summaries) {
+        if (!summary.archived) {
+            continue;
+        }
+        if (std::shared_ptr<const OrderSegment> archived = segment(summary.month)) {
+            result.segments.append(archived);
+        } else {
+            result.summaries.append(summary);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,98 @@
+#ifndef ORDERPARTITIONS_H
+#define ORDERPARTITIONS_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QDate>
+#include <QJsonObject>
+#include <QMutex>
+#include <memory>
+#include "order.h"
+
+class OrderSegment;
+
+// Краткая сводка по заказам одного месяца: хранится в индексе и загружается
+// при запуске вместо самих заказов
+struct OrderPartitionSummary
+{
+    int month = 0;                      // ключ месяца, см. OrderPartitionStore::monthKey
+    int orderCount = 0;
+    qint64 revenueKopecks = 0;
+    int maxOrderId = 0;
+    QHash<int, qint64> mealQuantities;  // mealId -> количество порций
+    QList<int> userIds;                 // по возрастанию, без повторов
+    QMap<qint32, qint32> dailyCounts;   // QDate::toJulianDay() -> число заказов
+    QMap<qint32, qint64> dailyRevenue;  // QDate::toJulianDay() -> выручка в копейках
+    bool archived = false;              // месяц перенесен в архивный сегмент
+
+    static OrderPartitionSummary fromOrders(int month, const QList<Order> &orders);
+    QJsonObject toJson() const;
+    static OrderPartitionSummary fromJson(const QJsonObject &obj);
+};
+
+// Архивные месяцы для отчетов: отображенные сегменты сканируются как колонки,
+// для месяцев, сегмент которых не открылся, остаются сводки
+struct OrderArchive
+{
+    QList<std::shared_ptr<const OrderSegment>> segments;
+    QList<OrderPartitionSummary> summaries;
+};
+
+// Заказы на диске, разбитые по месяцам: <каталог>/YYYY-MM.json и общий индекс
+// index.json со сводками. Файлы пишутся через SnapshotStore (атомарно, с контрольной суммой).
+// Старые месяцы можно перенести в архив: <каталог>/archive/YYYY-MM.seg - неизменяемый
+// бинарный сегмент (OrderSegment), который читается через отображение в память.
+class OrderPartitionStore
+{
+public:
+    OrderPartitionStore();
+
+    void setDirectory(const QString &directory);
+    const QString &directory() const { return m_directory; }
+
+    // 2026-10-19 -> 202610
+    static int monthKey(const QDate &date);
+    static QDate monthStart(int month);
+    static int nextMonth(int month);
+
+    // Загружает index.json. Если индекса нет или он поврежден, сводки восстанавливаются
+    // по файлам месяцев и архивным сегментам (rebuildIndex); false - часть месяцев не прочиталась.
+    bool loadIndex();
+    const QMap<int, OrderPartitionSummary> &summaries() const { return m_summaries; }
+
+    bool isArchived(int month) const;
+    // Читает месяц из рабочего файла или из архивного сегмента
+    bool readPartition(int month, QList<Order> *orders) const;
+    // Пишет месяц целиком и обновляет его сводку (индекс сохраняется отдельно, writeIndex)
+    bool writePartition(int month, const QList<Order> &orders);
+    // Отказывает, пока после восстановления остаются непрочитанные месяцы:
+    // новый индекс без них сделал бы эти месяцы недоступными
+    bool writeIndex();
+    // Переносит месяц в архив: сегмент, затем индекс, затем удаление рабочего файла
+    bool archivePartition(int month, QString *errorMessage = nullptr);
+
+    // Отображенный сегмент архивного месяца (открывается при первом обращении).
+    // Потокобезопасно; nullptr, если сегмента нет или он поврежден.
+    std::shared_ptr<const OrderSegment> segment(int month) const;
+    OrderArchive archive() const;
+    // Объем уже открытых сегментов, новые не открываются
+    qint64 mappedSegmentBytes(int *segmentCount = nullptr) const;
+
+private:
+    QString partitionPath(int month) const;
+    QString archivePath(int month) const;
+    bool readArchive(int month, QList<Order> *orders) const;
+    bool rebuildIndex();
+
+    QString m_directory;
+    QMap<int, OrderPartitionSummary> m_summaries;
+    QSet<int> m_unreadableMonths; // не попали в восстановленный индекс
+
+    mutable QMutex m_segmentsMutex;
+    mutable QHash<int, std::shared_ptr<const OrderSegment>> m_segments;
+};
+
+#endif // ORDERPARTITIONS_H
@@ -0,0 +1,42 @@
+#include "orderprotocol.h"
+#include <QtEndian>
+
+namespace OrderProtocol {
+
+// Кадры больше этого размера считаются повреждением потока
+constexpr quint32 MaxFrameSize = 1 << 20;
+
+QString defaultServerName()
+{
+    return "canteen-orders";
+}
+
+QByteArray frame(const QByteArray &payload)
+{
+    QByteArray result(sizeof(quint32), Qt::Uninitialized);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), result.data());
+    result.append(payload);
+    return result;
+}
+
+FrameStatus takeFrame(QByteArray &buffer, QByteArray *payload)
+{
+    if (buffer.size() < static_cast<qsizetype>(sizeof(quint32))) {
+        return FrameStatus::Incomplete;
+    }
+    
+    // Остаток такого кадра нельзя отличить от следующих кадров - буфер не трогаем
+    const quint32 size = qFromBigEndian<quint32>(buffer.constData());
+    if (size > MaxFrameSize) {
+        return FrameStatus::Corrupt;
+    }
+    if (buffer.size() < static_cast<qsizetype>(sizeof(quint32) + size)) {
+        return FrameStatus::Incomplete;
+    }
+    
+    *payload = buffer.mid(sizeof(quint32), size);
+    buffer.remove(0, sizeof(quint32) + size);
+    return FrameStatus::Ready;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef ORDERPROTOCOL_H
+#define ORDERPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+
+// Двоичный протокол между сервисом заказов и киосками.
+// Кадр: quint32 длина (big-endian) + тело, записанное QDataStream.
+//
+// PlaceOrderRequest: quint8 тип, quint32 requestId, qint32 userId,
+//                    quint32 число позиций, (qint32 mealId, qint32 quantity) * n
+// PlaceOrderReply:   quint8 тип, quint32 requestId, bool ok, qint32 orderId,
+//                    qint64 сумма в копейках, qint64 баланс в копейках, QString ошибка
+namespace OrderProtocol {
+
+enum MessageType : quint8 {
+    PlaceOrderRequest = 1,
+    PlaceOrderReply = 2
+};
+
+QString defaultServerName();
+
+QByteArray frame(const QByteArray &payload);
+
+enum class FrameStatus {
+    Ready,       // кадр извлечен в payload
+    Incomplete,  // кадр еще не дочитан
+    Corrupt      // длина кадра недопустима: поток рассинхронизирован, соединение надо закрыть
+};
+
+// Извлекает из начала buffer очередной полный кадр
+FrameStatus takeFrame(QByteArray &buffer, QByteArray *payload);
+
+}
+
+#endif // ORDERPROTOCOL_H
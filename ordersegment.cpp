@@ -0,0 +1,209 @@
+#include "ordersegment.h"
+#include "checksum.h"
+#include "filesync.h"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const char SegmentMagic[8] = { 'C', 'N', 'T', 'S', 'E', 'G', '0', '2' };
+constexpr quint32 ByteOrderMark = 0x01020304;
+
+// Заголовок занимает 64 байта, чтобы колонки начинались с выровненного смещения
+struct SegmentHeader
+{
+    char magic[8];
+    quint32 byteOrder;
+    quint32 month;
+    quint32 orderCount;
+    quint32 lineCount;
+    quint32 checksum;   // CRC32C всего, что после заголовка
+    quint32 reserved[9];
+};
+static_assert(sizeof(SegmentHeader) == 64, "segment header layout is part of the file format");
+
+constexpr qint64 alignUp(qint64 value)
+{
+    return (value + 7) & ~qint64(7);
+}
+
+}
+
+OrderSegment::OrderSegment()
+    : m_data(nullptr)
+    , m_month(0)
+    , m_orderCount(0)
+    , m_lineCount(0)
+    , m_checksum(0)
+    , m_offsets{}
+    , m_verified(-1)
+{
+}
+
+OrderSegment::~OrderSegment()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+}
+
+std::array<qint64, OrderSegment::ColumnCount + 1> OrderSegment::layout(qsizetype orderCount, qsizetype lineCount)
+{
+    const qint64 sizes[ColumnCount] = {
+        qint64(sizeof(qint32)) * orderCount,       // Ids
+        qint64(sizeof(qint32)) * orderCount,       // UserIds
+        qint64(sizeof(qint32)) * orderCount,       // Days
+        qint64(sizeof(qint64)) * orderCount,       // Totals
+        qint64(sizeof(qint32)) * (orderCount + 1), // LineOffsets
+        qint64(sizeof(qint32)) * lineCount,        // LineMealIds
+        qint64(sizeof(qint32)) * lineCount,        // LineQuantities
+    };
+
+    std::array<qint64, ColumnCount + 1> offsets{};
+    qint64 offset = sizeof(SegmentHeader);
+    for (int c = 0; c < ColumnCount; ++c) {
+        offsets[c] = offset;
+        offset = alignUp(offset + sizes[c]);
+    }
+    offsets[ColumnCount] = offset;
+    return offsets;
+}
+
+bool OrderSegment::write(const QString &path, int month, const QList<Order> &orders, QString *errorMessage)
+{
+    const OrderColumns source = OrderColumns::fromOrders(orders);
+    const auto offsets = layout(source.size(), source.lineCount());
+
+    QByteArray content(offsets[ColumnCount], '\0');
+    char *data = content.data();
+    auto put = [data, &offsets](Column c, const void *values, qint64 bytes) {
+        if (bytes > 0) {
+            std::memcpy(data + offsets[c], values, bytes);
+        }
+    };
+
+    QVector<qint32> ids;
+    ids.reserve(orders.size());
+    for (const Order &order : orders) {
+        ids.append(order.getId());
+    }
+    put(Ids, ids.constData(), ids.size() * sizeof(qint32));
+    put(UserIds, source.userIds().constData(), source.size() * sizeof(qint32));
+    put(Days, source.days().constData(), source.size() * sizeof(qint32));
+    put(Totals, source.totals().constData(), source.size() * sizeof(qint64));
+    put(LineOffsets, source.lineOffsets().constData(), (source.size() + 1) * sizeof(qint32));
+    put(LineMealIds, source.lineMealIds().constData(), source.lineCount() * sizeof(qint32));
+    put(LineQuantities, source.lineQuantities().constData(), source.lineCount() * sizeof(qint32));
+
+    SegmentHeader header{};
+    std::memcpy(header.magic, SegmentMagic, sizeof(SegmentMagic));
+    header.byteOrder = ByteOrderMark;
+    header.month = quint32(month);
+    header.orderCount = quint32(source.size());
+    header.lineCount = quint32(source.lineCount());
+    header.checksum = Checksum::crc32c(data + sizeof(SegmentHeader), content.size() - qsizetype(sizeof(SegmentHeader)));
+    std::memcpy(data, &header, sizeof(header));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(content) != content.size()
+        || !syncToDisk(file)
+        || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    syncDirectory(QFileInfo(path).absolutePath());
+    return true;
+}
+
+bool OrderSegment::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < qint64(sizeof(SegmentHeader))) {
+        return false;
+    }
+
+    // Файл остается открытым на время жизни отображения
+    uchar *data = m_file.map(0, m_file.size());
+    if (!data) {
+        return false;
+    }
+
+    SegmentHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const auto offsets = layout(header.orderCount, header.lineCount);
+    if (std::memcmp(header.magic, SegmentMagic, sizeof(SegmentMagic)) != 0
+        || header.byteOrder != ByteOrderMark
+        || offsets[ColumnCount] != m_file.size()) {
+        qWarning() << "Orders: invalid segment header in" << path;
+        m_file.unmap(data);
+        return false;
+    }
+
+    m_data = data;
+    m_month = int(header.month);
+    m_orderCount = header.orderCount;
+    m_lineCount = header.lineCount;
+    m_checksum = header.checksum;
+    m_offsets = offsets;
+    return true;
+}
+
+bool OrderSegment::verify() const
+{
+    if (!m_data) {
+        return false;
+    }
+    int verified = m_verified.load(std::memory_order_acquire);
+    if (verified < 0) {
+        const quint32 actual = Checksum::crc32c(reinterpret_cast<const char *>(m_data) + sizeof(SegmentHeader),
+                                                m_offsets[ColumnCount] - qint64(sizeof(SegmentHeader)));
+        verified = actual == m_checksum ? 1 : 0;
+        m_verified.store(verified, std::memory_order_release);
+        if (!verified) {
+            qWarning() << "Orders: checksum mismatch in" << m_file.fileName();
+        }
+    }
+    return verified == 1;
+}
+
+OrderColumnsView OrderSegment::columns() const
+{
+    OrderColumnsView view;
+    view.days = column<qint32>(Days);
+    view.totals = column<qint64>(Totals);
+    view.userIds = column<qint32>(UserIds);
+    view.size = m_orderCount;
+    view.lineOffsets = column<qint32>(LineOffsets);
+    view.lineMealIds = column<qint32>(LineMealIds);
+    view.lineQuantities = column<qint32>(LineQuantities);
+    view.lineCount = m_lineCount;
+    return view;
+}
+
+Order OrderSegment::orderAt(qsizetype row) const
+{
+    const OrderColumnsView view = columns();
+    OrderLines lines;
+    for (qint32 i = view.lineOffsets[row]; i < view.lineOffsets[row + 1]; ++i) {
+        lines.append(qMakePair(view.lineMealIds[i], view.lineQuantities[i]));
+    }
+    const QDate date = view.days[row] == OrderColumns::InvalidDay ? QDate() : QDate::fromJulianDay(view.days[row]);
+    Order order(ids()[row], view.userIds[row], date, std::move(lines));
+    order.setTotalPrice(Money::fromKopecks(view.totals[row]));
+    return order;
+}
+
+QList<Order> OrderSegment::toOrders() const
+{
+    QList<Order> orders;
+    orders.reserve(m_orderCount);
+    for (qsizetype row = 0; row < m_orderCount; ++row) {
+        orders.append(orderAt(row));
+    }
+    return orders;
+}
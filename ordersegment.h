@@ -0,0 +1,63 @@
+#ifndef ORDERSEGMENT_H
+#define ORDERSEGMENT_H
+
+#include <QString>
+#include <QList>
+#include <QFile>
+#include <array>
+#include <atomic>
+#include "order.h"
+#include "ordercolumns.h"
+
+// Неизменяемый архивный сегмент заказов за месяц в бинарном виде с фиксированной раскладкой:
+// заголовок, затем колонки ids, userIds, days (int32), totals (int64), lineOffsets,
+// lineMealIds, lineQuantities (int32), каждая выровнена на 8 байт.
+// Файл отображается в память (QFile::map) и читается на месте без разбора; несколько
+// киосков на одной машине делят страницы через кэш ОС. Порядок байт - родной для x86/ARM (little-endian).
+class OrderSegment
+{
+public:
+    OrderSegment();
+    ~OrderSegment();
+    OrderSegment(const OrderSegment&) = delete;
+    OrderSegment& operator=(const OrderSegment&) = delete;
+
+    static bool write(const QString &path, int month, const QList<Order> &orders, QString *errorMessage = nullptr);
+
+    // Отображает файл в память; проверяется только заголовок и размер
+    bool open(const QString &path);
+    bool isOpen() const { return m_data != nullptr; }
+
+    // Проверяет контрольную сумму колонок (читает весь файл); результат запоминается
+    bool verify() const;
+
+    int month() const { return m_month; }
+    qsizetype size() const { return m_orderCount; }
+    qsizetype lineCount() const { return m_lineCount; }
+    qint64 mappedBytes() const { return m_data ? m_offsets[ColumnCount] : 0; }
+
+    const qint32 *ids() const { return column<qint32>(Ids); }
+    OrderColumnsView columns() const;
+
+    Order orderAt(qsizetype row) const;
+    QList<Order> toOrders() const;
+
+private:
+    enum Column { Ids, UserIds, Days, Totals, LineOffsets, LineMealIds, LineQuantities, ColumnCount };
+
+    static std::array<qint64, ColumnCount + 1> layout(qsizetype orderCount, qsizetype lineCount);
+
+    template <typename T>
+    const T *column(Column c) const { return reinterpret_cast<const T *>(m_data + m_offsets[c]); }
+
+    QFile m_file;
+    const uchar *m_data;
+    int m_month;
+    qsizetype m_orderCount;
+    qsizetype m_lineCount;
+    quint32 m_checksum;
+    std::array<qint64, ColumnCount + 1> m_offsets; // последний элемент - размер файла
+    mutable std::atomic<int> m_verified;           // -1 - не проверен, 0 - поврежден, 1 - цел
+};
+
+#endif // ORDERSEGMENT_H
@@ -0,0 +1,147 @@
+#include "orderservice.h"
+#include "orderprotocol.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QTimer>
+#include <QDebug>
+
+OrderService::OrderService(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+    , m_flushTimer(new QTimer(this))
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(BatchWindowMs);
+    
+    connect(m_server, &QLocalServer::newConnection, this, &OrderService::onNewConnection);
+    connect(m_flushTimer, &QTimer::timeout, this, &OrderService::flushPending);
+}
+
+bool OrderService::listen(const QString &serverName)
+{
+    // Сокет мог остаться после аварийного завершения прошлого запуска
+    QLocalServer::removeServer(serverName);
+    return m_server->listen(serverName);
+}
+
+QString OrderService::errorString() const
+{
+    return m_server->errorString();
+}
+
+void OrderService::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QLocalSocket::readyRead, this, &OrderService::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &OrderService::onDisconnected);
+    }
+}
+
+void OrderService::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+    
+    QByteArray &buffer = m_buffers[socket];
+    buffer.append(socket->readAll());
+    
+    QByteArray payload;
+    OrderProtocol::FrameStatus status;
+    while ((status = OrderProtocol::takeFrame(buffer, &payload)) == OrderProtocol::FrameStatus::Ready) {
+        handleMessage(socket, payload);
+    }
+    if (status == OrderProtocol::FrameStatus::Corrupt) {
+        // Принятые раньше заказы этого киоска остаются в пакете; сокет закроет onDisconnected
+        qWarning() << "Service: corrupt frame from a client, closing the connection";
+        m_buffers.remove(socket);
+        socket->abort();
+    }
+    
+    if (m_pending.size() >= MaxBatchSize) {
+        flushPending();
+    } else if (!m_pending.isEmpty() && !m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void OrderService::onDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (socket) {
+        m_buffers.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+void OrderService::handleMessage(QLocalSocket *socket, const QByteArray &payload)
+{
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_15);
+    
+    quint8 type;
+    in >> type;
+    if (type != OrderProtocol::PlaceOrderRequest) {
+        return;
+    }
+    
+    PendingOrder pending;
+    pending.socket = socket;
+    quint32 lineCount;
+    qint32 userId;
+    in >> pending.requestId >> userId >> lineCount;
+    pending.request.userId = userId;
+    for (quint32 i = 0; i < lineCount && in.status() == QDataStream::Ok; ++i) {
+        qint32 mealId;
+        qint32 quantity;
+        in >> mealId >> quantity;
+        pending.request.cart.append(qMakePair(mealId, quantity));
+    }
+    
+    if (in.status() == QDataStream::Ok) {
+        m_pending.append(pending);
+    }
+}
+
+void OrderService::flushPending()
+{
+    m_flushTimer->stop();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    
+    const QList<PendingOrder> batch = std::move(m_pending);
+    m_pending.clear();
+    
+    QList<OrderRequest> requests;
+    requests.reserve(batch.size());
+    for (const PendingOrder &pending : batch) {
+        requests.append(pending.request);
+    }
+    
+    // Ответ каждому киоску уходит только после общей фиксации пакета
+    const QList<OrderResult> results = DataManager::getInstance().placeOrders(requests);
+    
+    for (int i = 0; i < batch.size(); ++i) {
+        QLocalSocket *socket = batch[i].socket;
+        if (!socket) {
+            continue;
+        }
+        
+        const OrderResult &result = results[i];
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_15);
+        out << quint8(OrderProtocol::PlaceOrderReply)
+            << batch[i].requestId
+            << bool(result.order.has_value())
+            << qint32(result.order ? result.order->getId() : 0)
+            << qint64(result.order ? result.order->getTotalPrice().kopecks() : 0)
+            << qint64(result.balance.kopecks())
+            << result.error;
+        socket->write(OrderProtocol::frame(payload));
+    }
+}
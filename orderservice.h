@@ -0,0 +1,54 @@
+#ifndef ORDERSERVICE_H
+#define ORDERSERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QByteArray>
+#include "datamanager.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+// Сервис заказов: единственный владелец DataManager, к которому по QLocalSocket
+// подключаются киоски. Заказы, пришедшие почти одновременно, фиксируются пакетом
+// (DataManager::placeOrders): одна запись в журнал и один fsync на пакет.
+class OrderService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OrderService(QObject *parent = nullptr);
+    
+    bool listen(const QString &serverName);
+    QString errorString() const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void flushPending();
+
+private:
+    struct PendingOrder
+    {
+        QPointer<QLocalSocket> socket;
+        quint32 requestId;
+        OrderRequest request;
+    };
+    
+    // Пакет отправляется по истечении окна или при наборе MaxBatchSize заказов
+    static constexpr int BatchWindowMs = 2;
+    static constexpr int MaxBatchSize = 64;
+    
+    void handleMessage(QLocalSocket *socket, const QByteArray &payload);
+    
+    QLocalServer *m_server;
+    QTimer *m_flushTimer;
+    QHash<QLocalSocket*, QByteArray> m_buffers;
+    QList<PendingOrder> m_pending;
+};
+
+#endif // ORDERSERVICE_H
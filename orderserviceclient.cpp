@@ -0,0 +1,83 @@
+#include "orderserviceclient.h"
+#include "orderprotocol.h"
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QDeadlineTimer>
+
+OrderServiceClient::OrderServiceClient(QObject *parent)
+    : QObject(parent)
+    , m_socket(new QLocalSocket(this))
+    , m_nextRequestId(1)
+{
+}
+
+bool OrderServiceClient::connectToServer(const QString &serverName, int timeoutMs)
+{
+    m_socket->connectToServer(serverName);
+    return m_socket->waitForConnected(timeoutMs);
+}
+
+bool OrderServiceClient::isConnected() const
+{
+    return m_socket->state() == QLocalSocket::ConnectedState;
+}
+
+bool OrderServiceClient::placeOrder(int userId, const QList<OrderLine> &cart, QString *errorMessage)
+{
+    auto fail = [errorMessage](const QString &message) {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+        return false;
+    };
+    
+    if (!isConnected()) {
+        return fail("Нет связи с сервисом заказов");
+    }
+    
+    const quint32 requestId = m_nextRequestId++;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << quint8(OrderProtocol::PlaceOrderRequest) << requestId << qint32(userId) << quint32(cart.size());
+    for (const OrderLine &line : cart) {
+        out << qint32(line.first) << qint32(line.second);
+    }
+    m_socket->write(OrderProtocol::frame(payload));
+    m_socket->flush();
+    
+    QDeadlineTimer deadline(ReplyTimeoutMs);
+    QByteArray reply;
+    while (true) {
+        OrderProtocol::FrameStatus status;
+        while ((status = OrderProtocol::takeFrame(m_buffer, &reply)) == OrderProtocol::FrameStatus::Ready) {
+            QDataStream in(reply);
+            in.setVersion(QDataStream::Qt_5_15);
+            quint8 type;
+            quint32 replyId;
+            in >> type >> replyId;
+            if (type != OrderProtocol::PlaceOrderReply || replyId != requestId) {
+                continue;
+            }
+            
+            bool ok;
+            qint32 orderId;
+            qint64 totalKopecks;
+            qint64 balanceKopecks;
+            QString error;
+            in >> ok >> orderId >> totalKopecks >> balanceKopecks >> error;
+            return ok ? true : fail(error);
+        }
+        if (status == OrderProtocol::FrameStatus::Corrupt) {
+            // Дальше поток не разобрать: соединение разрывается, как при потере связи
+            m_buffer.clear();
+            m_socket->abort();
+            return fail("Поврежден ответ сервиса заказов");
+        }
+        
+        if (deadline.hasExpired() || !m_socket->waitForReadyRead(deadline.remainingTime())) {
+            return fail("Сервис заказов не ответил");
+        }
+        m_buffer.append(m_socket->readAll());
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef ORDERSERVICECLIENT_H
+#define ORDERSERVICECLIENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include "order.h"
+
+class QLocalSocket;
+
+// Клиент сервиса заказов для киосков (режим --connect)
+class OrderServiceClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OrderServiceClient(QObject *parent = nullptr);
+    
+    bool connectToServer(const QString &serverName, int timeoutMs = 3000);
+    bool isConnected() const;
+    
+    // Синхронный вызов: возвращает управление после фиксации заказа на сервере
+    bool placeOrder(int userId, const QList<OrderLine> &cart, QString *errorMessage = nullptr);
+
+private:
+    static constexpr int ReplyTimeoutMs = 5000;
+    
+    QLocalSocket *m_socket;
+    QByteArray m_buffer;
+    quint32 m_nextRequestId;
+};
+
+#endif // ORDERSERVICECLIENT_H
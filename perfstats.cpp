@@ -0,0 +1,278 @@
+#include "perfstats.h"
+#include <QMutex>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QtAlgorithms>
+#include <QByteArray>
+#include <atomic>
+
+namespace PerfStats {
+
+namespace {
+
+struct SiteCounters
+{
+    std::atomic<quint64> count{0};
+    std::atomic<quint64> total{0};
+    std::atomic<quint64> max{0};
+    std::atomic<quint64> buckets[BucketCount] = {};
+};
+
+// Счетчики одного потока: пишет только владелец, читает snapshot
+struct ThreadBlock
+{
+    SiteCounters sites[MaxSites];
+};
+
+struct Registry
+{
+    QMutex mutex;
+    const char *names[MaxSites] = {};
+    bool counters[MaxSites] = {};
+    int siteCount = 0;
+    QList<ThreadBlock *> threads;
+    ThreadBlock retired; // итоги завершившихся потоков
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+void mergeInto(SiteCounters &target, const SiteCounters &source)
+{
+    target.count.fetch_add(source.count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    target.total.fetch_add(source.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    const quint64 sourceMax = source.max.load(std::memory_order_relaxed);
+    if (sourceMax > target.max.load(std::memory_order_relaxed)) {
+        target.max.store(sourceMax, std::memory_order_relaxed);
+    }
+    for (int b = 0; b < BucketCount; ++b) {
+        target.buckets[b].fetch_add(source.buckets[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void clear(SiteCounters &counters)
+{
+    counters.count.store(0, std::memory_order_relaxed);
+    counters.total.store(0, std::memory_order_relaxed);
+    counters.max.store(0, std::memory_order_relaxed);
+    for (auto &bucket : counters.buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Блок регистрируется при первом замере в потоке; при завершении потока
+// его итоги переносятся в retired, чтобы короткие рабочие потоки не копились
+struct ThreadHandle
+{
+    ThreadBlock *block;
+
+    ThreadHandle()
+        : block(new ThreadBlock)
+    {
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        r.threads.append(block);
+    }
+
+    ~ThreadHandle()
+    {
+        Registry &r = registry();
+        QMutexLocker locker(&r.mutex);
+        for (int s = 0; s < r.siteCount; ++s) {
+            mergeInto(r.retired.sites[s], block->sites[s]);
+        }
+        r.threads.removeOne(block);
+        delete block;
+    }
+};
+
+ThreadBlock &localBlock()
+{
+    thread_local ThreadHandle handle;
+    return *handle.block;
+}
+
+int bucketFor(quint64 nanoseconds)
+{
+    if (nanoseconds == 0) {
+        return 0;
+    }
+    return qMin(63 - int(qCountLeadingZeroBits(nanoseconds)), BucketCount - 1);
+}
+
+}
+
+quint64 SiteSnapshot::percentileNs(double percentile) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    const quint64 rank = quint64(percentile / 100.0 * double(count - 1)) + 1;
+    quint64 seen = 0;
+    for (int b = 0; b < BucketCount; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return qMin(quint64(1) << (b + 1), max);
+        }
+    }
+    return max;
+}
+
+bool isEnabled()
+{
+#ifdef CANTEEN_PERF_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+int registerSite(const char *name, bool counter)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    for (int s = 0; s < r.siteCount; ++s) {
+        if (qstrcmp(r.names[s], name) == 0) {
+            return s;
+        }
+    }
+    if (r.siteCount == MaxSites) {
+        return -1;
+    }
+    r.names[r.siteCount] = name;
+    r.counters[r.siteCount] = counter;
+    return r.siteCount++;
+}
+
+const char *siteName(int site)
+{
+    // Имена только дописываются, и индекс точки получен после записи ее имени
+    if (site < 0 || site >= MaxSites) {
+        return nullptr;
+    }
+    return registry().names[site];
+}
+
+void record(int site, qint64 nanoseconds)
+{
+    if (site < 0) {
+        return;
+    }
+    const quint64 value = nanoseconds > 0 ? quint64(nanoseconds) : 0;
+    SiteCounters &counters = localBlock().sites[site];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.total.fetch_add(value, std::memory_order_relaxed);
+    counters.buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    // Писатель у блока один, поэтому сравнение и запись без цикла CAS
+    if (value > counters.max.load(std::memory_order_relaxed)) {
+        counters.max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void add(int site, qint64 amount)
+{
+    if (site < 0) {
+        return;
+    }
+    SiteCounters &counters = localBlock().sites[site];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.total.fetch_add(quint64(qMax<qint64>(amount, 0)), std::memory_order_relaxed);
+}
+
+QList<SiteSnapshot> snapshot()
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    QList<SiteSnapshot> result;
+    result.reserve(r.siteCount);
+    for (int s = 0; s < r.siteCount; ++s) {
+        SiteCounters merged;
+        mergeInto(merged, r.retired.sites[s]);
+        for (const ThreadBlock *block : r.threads) {
+            mergeInto(merged, block->sites[s]);
+        }
+
+        SiteSnapshot site;
+        site.name = QString::fromLatin1(r.names[s]);
+        site.counter = r.counters[s];
+        site.count = merged.count.load(std::memory_order_relaxed);
+        site.total = merged.total.load(std::memory_order_relaxed);
+        site.max = merged.max.load(std::memory_order_relaxed);
+        for (int b = 0; b < BucketCount; ++b) {
+            site.buckets[b] = merged.buckets[b].load(std::memory_order_relaxed);
+        }
+        result.append(site);
+    }
+    return result;
+}
+
+void reset()
+{
+    // Одновременные замеры в других потоках могут пережить сброс - для диагностики это допустимо
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    for (int s = 0; s < r.siteCount; ++s) {
+        clear(r.retired.sites[s]);
+        for (ThreadBlock *block : r.threads) {
+            clear(block->sites[s]);
+        }
+    }
+}
+
+QJsonObject toJson()
+{
+    QJsonArray sites;
+    for (const SiteSnapshot &site : snapshot()) {
+        QJsonObject obj;
+        obj["name"] = site.name;
+        obj["type"] = site.counter ? "counter" : "timer";
+        obj["count"] = qint64(site.count);
+        if (site.counter) {
+            obj["total"] = qint64(site.total);
+        } else {
+            obj["totalMs"] = double(site.total) / 1e6;
+            obj["meanUs"] = site.meanNs() / 1e3;
+            obj["p50Us"] = double(site.percentileNs(50)) / 1e3;
+            obj["p95Us"] = double(site.percentileNs(95)) / 1e3;
+            obj["p99Us"] = double(site.percentileNs(99)) / 1e3;
+            obj["maxUs"] = double(site.max) / 1e3;
+            QJsonArray buckets;
+            int last = BucketCount - 1;
+            while (last > 0 && site.buckets[last] == 0) {
+                --last;
+            }
+            for (int b = 0; b <= last; ++b) {
+                buckets.append(qint64(site.buckets[b]));
+            }
+            obj["log2NsBuckets"] = buckets;
+        }
+        sites.append(obj);
+    }
+
+    QJsonObject root;
+    root["enabled"] = isEnabled();
+    root["generated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["sites"] = sites;
+    return root;
+}
+
+bool dumpToFile(const QString &path, QString *errorMessage)
+{
+    QSaveFile file(path);
+    const QByteArray data = QJsonDocument(toJson()).toJson(QJsonDocument::Indented);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+}
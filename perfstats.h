@@ -0,0 +1,92 @@
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <QString>
+#include <QList>
+#include <QJsonObject>
+#include <array>
+#include <chrono>
+#include "traceevents.h"
+
+// Легковесные замеры времени и счетчики.
+// PERF_SCOPE("имя") замеряет время до конца блока, PERF_COUNT("имя", n) прибавляет n к счетчику.
+// Каждый поток пишет в свой блок гистограмм без блокировок; блоки сводятся при чтении (snapshot).
+// Гистограмма логарифмическая: корзина b - длительности [2^b, 2^(b+1)) нс.
+// Без CANTEEN_PERF_STATS (опция CMake) макросы раскрываются в пустоту, а snapshot пуст.
+// Те же точки попадают в трассировку, если она включена (traceevents.h).
+namespace PerfStats {
+
+constexpr int MaxSites = 64;
+constexpr int BucketCount = 40;
+
+struct SiteSnapshot
+{
+    QString name;
+    bool counter = false;   // счетчик (total - сумма значений), а не замер времени
+    quint64 count = 0;
+    quint64 total = 0;      // наносекунды для замеров
+    quint64 max = 0;
+    std::array<quint64, BucketCount> buckets{};
+
+    double meanNs() const { return count ? double(total) / double(count) : 0.0; }
+    // Оценка перцентиля по гистограмме (верхняя граница корзины, не больше max)
+    quint64 percentileNs(double percentile) const;
+};
+
+bool isEnabled();
+
+// Регистрирует точку замера; вызывается один раз на точку (статической переменной в макросе)
+int registerSite(const char *name, bool counter = false);
+void record(int site, qint64 nanoseconds);
+void add(int site, qint64 amount);
+// Имя точки (строка из PERF_SCOPE, живет до конца процесса); nullptr для неизвестной
+const char *siteName(int site);
+
+QList<SiteSnapshot> snapshot();
+void reset();
+QJsonObject toJson();
+bool dumpToFile(const QString &path, QString *errorMessage = nullptr);
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(int site)
+        : m_site(site)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedTimer()
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+        record(m_site, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        if (TraceEvents::isActive()) {
+            TraceEvents::complete(siteName(m_site), m_start, elapsed);
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    int m_site;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+}
+
+#ifdef CANTEEN_PERF_STATS
+#define PERF_CONCAT_IMPL(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_IMPL(a, b)
+#define PERF_SCOPE(name) \
+    static const int PERF_CONCAT(perfSite_, __LINE__) = PerfStats::registerSite(name); \
+    PerfStats::ScopedTimer PERF_CONCAT(perfTimer_, __LINE__)(PERF_CONCAT(perfSite_, __LINE__))
+#define PERF_COUNT(name, amount) \
+    do { \
+        static const int perfSite = PerfStats::registerSite(name, true); \
+        PerfStats::add(perfSite, amount); \
+    } while (0)
+#else
+#define PERF_SCOPE(name) do {} while (0)
+#define PERF_COUNT(name, amount) do {} while (0)
+#endif
+
+#endif // PERFSTATS_H
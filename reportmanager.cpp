@@ -31,6 +31,22 @@ QString ReportManager::generateReport(const QList<Order> &orders,
     return "Стратегия не установлена";
 }
 
+void ReportManager::setArchive(const OrderArchive &archive)
+{
+    m_archive = archive;
+}
+
+QString ReportManager::generateReport(const OrderColumns &orders,
+                                     const QList<Meal> &meals,
+                                     const QList<User> &users)
+{
+    if (m_strategy) {
+        m_strategy->setArchive(m_archive);
+        return m_strategy->generateReport(orders, meals, users);
+    }
+    return "Стратегия не установлена";
+}
+
 
 
 
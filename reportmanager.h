@@ -12,12 +12,18 @@ public:
     ~ReportManager();
     
     void setStrategy(ReportStrategy *strategy);
+    // Архивные месяцы, которые добавляются к отчетам по колонкам
+    void setArchive(const OrderArchive &archive);
     QString generateReport(const QList<Order> &orders,
                           const QList<Meal> &meals,
                           const QList<User> &users);
+    QString generateReport(const OrderColumns &orders,
+                          const QList<Meal> &meals,
+                          const QList<User> &users);
     
 private:
     ReportStrategy *m_strategy;
+    OrderArchive m_archive;
 };
 
 #endif // REPORTMANAGER_H
@@ -1,66 +1,289 @@
 #include "reportstrategy.h"
 #include "user.h"
+#include "aggregationkernels.h"
+#include "ordersegment.h"
+#include "perfstats.h"
+#include "scratcharena.h"
+#include "stringpool.h"
 #include <QDate>
 #include <algorithm>
+#include <limits>
+#include <map>
+#include <unordered_map>
 
-QString RevenueReportStrategy::generateReport(const QList<Order> &orders,
+namespace {
+
+QString formatRubles(qint64 kopecks)
+{
+    return Money::fromKopecks(kopecks).toString();
+}
+
+// Плотные массивы по ключу (дню, id блюда) строятся не больше этого размера. Если ключи
+// разбросаны шире (ошибочная дата, большой id из импортированного файла), используется
+// разреженный путь, а не выделение гигабайтов под почти пустой массив.
+constexpr qint64 MaxDenseKeys = 1 << 16;
+
+// Выручка и число заказов по дням: только дни с заказами, по возрастанию.
+// Память берется из арены отчета и освобождается вместе с ней.
+struct DailyTotals
+{
+    explicit DailyTotals(ScratchArena &arena)
+        : days(arena.resource())
+        , revenue(arena.resource())
+        , counts(arena.resource())
+    {
+    }
+
+    void append(qint32 day, qint64 dayRevenue, qint32 dayCount)
+    {
+        days.push_back(day);
+        revenue.push_back(dayRevenue);
+        counts.push_back(dayCount);
+    }
+
+    ScratchArena::Vector<qint32> days;  // QDate::toJulianDay()
+    ScratchArena::Vector<qint64> revenue;
+    ScratchArena::Vector<qint32> counts;
+};
+
+// Рабочие заказы и отображенные архивные сегменты сканируются одними ядрами
+ScratchArena::Vector<OrderColumnsView> columnViews(const OrderColumns &orders, const OrderArchive &archive,
+                                                  ScratchArena &arena)
+{
+    auto views = arena.vector<OrderColumnsView>();
+    views.reserve(archive.segments.size() + 1);
+    views.push_back(orders.view());
+    for (const auto &segment : archive.segments) {
+        views.push_back(segment->columns());
+    }
+    return views;
+}
+
+// Плотный путь: индекс массива - номер дня от minDay
+void aggregateDense(const ScratchArena::Vector<OrderColumnsView> &views,
+                    const QList<OrderPartitionSummary> &summaries,
+                    qint32 minDay, qint32 maxDay, ScratchArena &arena, DailyTotals &result)
+{
+    const std::size_t span = std::size_t(qint64(maxDay) - minDay + 1);
+    auto revenue = arena.vector<qint64>();
+    auto counts = arena.vector<qint32>();
+    revenue.assign(span, 0);
+    counts.assign(span, 0);
+    
+    // Некорректные даты (InvalidDay) лежат вне диапазона и пропускаются ядрами
+    for (const OrderColumnsView &view : views) {
+        AggregationKernels::groupedSum(view.days, view.totals, view.size,
+                                       minDay, revenue.data(), qsizetype(span));
+        AggregationKernels::groupedCount(view.days, view.size, minDay, counts.data(), qsizetype(span));
+    }
+    
+    // Архивы, сегмент которых не открылся, учитываются по сводкам
+    for (const OrderPartitionSummary &summary : summaries) {
+        for (auto it = summary.dailyCounts.cbegin(); it != summary.dailyCounts.cend(); ++it) {
+            if (it.key() != OrderColumns::InvalidDay) {
+                counts[it.key() - minDay] += it.value();
+                revenue[it.key() - minDay] += summary.dailyRevenue.value(it.key());
+            }
+        }
+    }
+    
+    for (std::size_t i = 0; i < span; ++i) {
+        if (counts[i] != 0) {
+            result.append(qint32(minDay + qint64(i)), revenue[i], counts[i]);
+        }
+    }
+}
+
+// Разреженный путь для широкого разброса дат: упорядоченное дерево на арене
+void aggregateSparse(const ScratchArena::Vector<OrderColumnsView> &views,
+                     const QList<OrderPartitionSummary> &summaries,
+                     ScratchArena &arena, DailyTotals &result)
+{
+    std::pmr::map<qint32, std::pair<qint64, qint32>> byDay(arena.resource());
+    for (const OrderColumnsView &view : views) {
+        for (qsizetype i = 0; i < view.size; ++i) {
+            if (view.days[i] != OrderColumns::InvalidDay) {
+                auto &day = byDay[view.days[i]];
+                day.first += view.totals[i];
+                day.second += 1;
+            }
+        }
+    }
+    for (const OrderPartitionSummary &summary : summaries) {
+        for (auto it = summary.dailyCounts.cbegin(); it != summary.dailyCounts.cend(); ++it) {
+            if (it.key() != OrderColumns::InvalidDay) {
+                auto &day = byDay[it.key()];
+                day.first += summary.dailyRevenue.value(it.key());
+                day.second += it.value();
+            }
+        }
+    }
+    
+    for (const auto &day : byDay) {
+        if (day.second.second != 0) {
+            result.append(day.first, day.second.first, day.second.second);
+        }
+    }
+}
+
+DailyTotals aggregateByDay(const ScratchArena::Vector<OrderColumnsView> &views,
+                           const QList<OrderPartitionSummary> &summaries, ScratchArena &arena)
+{
+    qint32 minDay = std::numeric_limits<qint32>::max();
+    qint32 maxDay = std::numeric_limits<qint32>::min();
+    bool found = false;
+    for (const OrderColumnsView &view : views) {
+        qint32 lo;
+        qint32 hi;
+        if (AggregationKernels::minMax(view.days, view.size, OrderColumns::InvalidDay, &lo, &hi)) {
+            minDay = std::min(minDay, lo);
+            maxDay = std::max(maxDay, hi);
+            found = true;
+        }
+    }
+    for (const OrderPartitionSummary &summary : summaries) {
+        for (auto it = summary.dailyCounts.cbegin(); it != summary.dailyCounts.cend(); ++it) {
+            if (it.key() != OrderColumns::InvalidDay) {
+                minDay = std::min(minDay, it.key());
+                maxDay = std::max(maxDay, it.key());
+                found = true;
+            }
+        }
+    }
+    
+    DailyTotals result(arena);
+    if (!found) {
+        return result;
+    }
+    if (qint64(maxDay) - minDay + 1 <= MaxDenseKeys) {
+        aggregateDense(views, summaries, minDay, maxDay, arena, result);
+    } else {
+        aggregateSparse(views, summaries, arena, result);
+    }
+    return result;
+}
+
+}
+
+QString ReportStrategy::generateReport(const QList<Order> &orders,
+                                       const QList<Meal> &meals,
+                                       const QList<User> &users)
+{
+    return generateReport(OrderColumns::fromOrders(orders), meals, users);
+}
+
+QString RevenueReportStrategy::generateReport(const OrderColumns &orders,
                                              const QList<Meal> &meals,
                                              const QList<User> &users)
 {
-    double totalRevenue = 0.0;
-    QMap<QDate, double> revenueByDate;
-    
-    for (const Order &order : orders) {
-        totalRevenue += order.getTotalPrice();
-        revenueByDate[order.getDate()] += order.getTotalPrice();
+    PERF_SCOPE("RevenueReportStrategy::generateReport");
+    ScratchArena arena;
+    const auto views = columnViews(orders, m_archive, arena);
+    qint64 totalRevenue = 0;
+    for (const OrderColumnsView &view : views) {
+        totalRevenue += AggregationKernels::sum(view.totals, view.size);
+    }
+    for (const OrderPartitionSummary &summary : m_archive.summaries) {
+        totalRevenue += summary.revenueKopecks;
     }
     
+    const DailyTotals daily = aggregateByDay(views, m_archive.summaries, arena);
+    
     QString report = "=== ОТЧЕТ О ВЫРУЧКЕ ===\n\n";
-    report += QString("Общая выручка: %1 руб.\n\n").arg(totalRevenue, 0, 'f', 2);
+    report += QString("Общая выручка: %1 руб.\n\n").arg(formatRubles(totalRevenue));
     
     report += "Выручка по датам:\n";
-    QList<QDate> dates = revenueByDate.keys();
-    std::sort(dates.begin(), dates.end());
-    
-    for (const QDate &date : dates) {
+    for (std::size_t i = 0; i < daily.days.size(); ++i) {
         report += QString("%1: %2 руб.\n")
-                  .arg(date.toString("dd.MM.yyyy"))
-                  .arg(revenueByDate[date], 0, 'f', 2);
+                  .arg(QDate::fromJulianDay(daily.days[i]).toString("dd.MM.yyyy"))
+                  .arg(formatRubles(daily.revenue[i]));
     }
     
     return report;
 }
 
-QString PopularDishesReportStrategy::generateReport(const QList<Order> &orders,
+QString PopularDishesReportStrategy::generateReport(const OrderColumns &orders,
                                                    const QList<Meal> &meals,
                                                    const QList<User> &users)
 {
-    QMap<int, int> mealCounts; // mealId -> quantity
+    PERF_SCOPE("PopularDishesReportStrategy::generateReport");
+    ScratchArena arena;
+    const auto views = columnViews(orders, m_archive, arena);
     
-    for (const Order &order : orders) {
-        for (const auto &mealPair : order.getMeals()) {
-            mealCounts[mealPair.first] += mealPair.second;
-        }
+    // В отчет попадают только блюда меню, поэтому плотный массив строится по их id
+    // (не больше MaxDenseKeys); блюда с большими id считаются через разреженную таблицу
+    qint32 maxMenuId = -1;
+    for (const Meal &meal : meals) {
+        maxMenuId = std::max(maxMenuId, meal.getId());
     }
-    
-    QMap<QString, int> mealNameCounts;
+    const qint32 denseSize = qint32(std::min<qint64>(qint64(maxMenuId) + 1, MaxDenseKeys));
+    std::pmr::unordered_map<qint32, qint64> sparseCounts(arena.resource());
     for (const Meal &meal : meals) {
-        if (mealCounts.contains(meal.getId())) {
-            mealNameCounts[meal.getName()] = mealCounts[meal.getId()];
+        if (meal.getId() >= denseSize) {
+            sparseCounts.emplace(meal.getId(), 0);
         }
     }
     
-    QString report = "=== ОТЧЕТ О ПОПУЛЯРНЫХ БЛЮДАХ ===\n\n";
+    auto mealCounts = arena.vector<qint64>(); // mealId -> quantity
+    mealCounts.assign(std::size_t(std::max(denseSize, 0)), 0);
+    for (const OrderColumnsView &view : views) {
+        AggregationKernels::histogram(view.lineMealIds, view.lineQuantities, view.lineCount,
+                                      mealCounts.data(), qsizetype(mealCounts.size()));
+        if (!sparseCounts.empty()) {
+            for (qsizetype i = 0; i < view.lineCount; ++i) {
+                if (view.lineMealIds[i] >= denseSize) {
+                    auto it = sparseCounts.find(view.lineMealIds[i]);
+                    if (it != sparseCounts.end()) {
+                        it->second += view.lineQuantities[i];
+                    }
+                }
+            }
+        }
+    }
+    for (const OrderPartitionSummary &summary : m_archive.summaries) {
+        for (auto it = summary.mealQuantities.cbegin(); it != summary.mealQuantities.cend(); ++it) {
+            if (it.key() >= 0 && it.key() < denseSize) {
+                mealCounts[it.key()] += it.value();
+            } else if (auto sparse = sparseCounts.find(it.key()); sparse != sparseCounts.end()) {
+                sparse->second += it.value();
+            }
+        }
+    }
     
-    // Сортируем по количеству заказов
-    QList<QPair<QString, int>> sorted;
-    for (auto it = mealNameCounts.begin(); it != mealNameCounts.end(); ++it) {
-        sorted.append(qMakePair(it.key(), it.value()));
+    // Без промежуточного QMap по названиям: пары разделяют данные строк блюд
+    auto sorted = arena.vector<QPair<QString, qint64>>();
+    for (const Meal &meal : meals) {
+        if (meal.getId() < 0) {
+            continue;
+        }
+        const qint64 count = meal.getId() < denseSize ? mealCounts[meal.getId()] : sparseCounts[meal.getId()];
+        if (count != 0) {
+            sorted.emplace_back(meal.getName(), count);
+        }
     }
+    
+    // Блюда с одинаковым названием (например, в разных категориях) - одна строка отчета
     std::sort(sorted.begin(), sorted.end(),
-              [](const QPair<QString, int> &a, const QPair<QString, int> &b) {
-                  return a.second > b.second;
+              [](const QPair<QString, qint64> &a, const QPair<QString, qint64> &b) {
+                  return a.first < b.first;
               });
+    std::size_t merged = 0;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        if (merged > 0 && StringPool::equal(sorted[merged - 1].first, sorted[i].first)) {
+            sorted[merged - 1].second += sorted[i].second;
+        } else {
+            sorted[merged++] = sorted[i];
+        }
+    }
+    sorted.resize(merged);
+    
+    QString report = "=== ОТЧЕТ О ПОПУЛЯРНЫХ БЛЮДАХ ===\n\n";
+    
+    // Сортируем по количеству заказов, при равенстве - по названию
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const QPair<QString, qint64> &a, const QPair<QString, qint64> &b) {
+                         return a.second > b.second;
+                     });
     
     for (const auto &pair : sorted) {
         report += QString("%1: %2 порций\n").arg(pair.first).arg(pair.second);
@@ -69,33 +292,20 @@ QString PopularDishesReportStrategy::generateReport(const QList<Order> &orders,
     return report;
 }
 
-QString OrdersByDateReportStrategy::generateReport(const QList<Order> &orders,
+QString OrdersByDateReportStrategy::generateReport(const OrderColumns &orders,
                                                   const QList<Meal> &meals,
                                                   const QList<User> &users)
 {
-    QMap<QDate, QList<Order>> ordersByDate;
-    
-    for (const Order &order : orders) {
-        ordersByDate[order.getDate()].append(order);
-    }
+    PERF_SCOPE("OrdersByDateReportStrategy::generateReport");
+    ScratchArena arena;
+    const DailyTotals daily = aggregateByDay(columnViews(orders, m_archive, arena), m_archive.summaries, arena);
     
     QString report = "=== ОТЧЕТ ПО ЗАКАЗАМ ПО ДАТАМ ===\n\n";
     
-    QList<QDate> dates = ordersByDate.keys();
-    std::sort(dates.begin(), dates.end());
-    
-    for (const QDate &date : dates) {
-        report += QString("\nДата: %1\n").arg(date.toString("dd.MM.yyyy"));
-        int count = 0;
-        double dayRevenue = 0.0;
-        
-        for (const Order &order : ordersByDate[date]) {
-            count++;
-            dayRevenue += order.getTotalPrice();
-        }
-        
-        report += QString("Количество заказов: %1\n").arg(count);
-        report += QString("Выручка за день: %1 руб.\n").arg(dayRevenue, 0, 'f', 2);
+    for (std::size_t i = 0; i < daily.days.size(); ++i) {
+        report += QString("\nДата: %1\n").arg(QDate::fromJulianDay(daily.days[i]).toString("dd.MM.yyyy"));
+        report += QString("Количество заказов: %1\n").arg(daily.counts[i]);
+        report += QString("Выручка за день: %1 руб.\n").arg(formatRubles(daily.revenue[i]));
     }
     
     return report;
@@ -6,6 +6,8 @@
 #include <QList>
 #include "order.h"
 #include "meal.h"
+#include "ordercolumns.h"
+#include "orderpartitions.h"
 
 class User;
 
@@ -13,15 +15,29 @@ class ReportStrategy
 {
 public:
     virtual ~ReportStrategy() = default;
-    virtual QString generateReport(const QList<Order> &orders, 
+    
+    // Отчеты считаются по колоночному представлению (DataManager::getOrderColumns)
+    virtual QString generateReport(const OrderColumns &orders,
                                    const QList<Meal> &meals,
                                    const QList<User> &users) = 0;
+    
+    QString generateReport(const QList<Order> &orders,
+                           const QList<Meal> &meals,
+                           const QList<User> &users);
+    
+    // Архивные месяцы в колонки не входят: их отображенные сегменты сканируются
+    // теми же ядрами, а для неоткрывшихся сегментов берутся сводки
+    void setArchive(const OrderArchive &archive) { m_archive = archive; }
+    
+protected:
+    OrderArchive m_archive;
 };
 
 class RevenueReportStrategy : public ReportStrategy
 {
 public:
-    QString generateReport(const QList<Order> &orders,
+    using ReportStrategy::generateReport;
+    QString generateReport(const OrderColumns &orders,
                           const QList<Meal> &meals,
                           const QList<User> &users) override;
 };
@@ -29,7 +45,8 @@ public:
 class PopularDishesReportStrategy : public ReportStrategy
 {
 public:
-    QString generateReport(const QList<Order> &orders,
+    using ReportStrategy::generateReport;
+    QString generateReport(const OrderColumns &orders,
                           const QList<Meal> &meals,
                           const QList<User> &users) override;
 };
@@ -37,7 +54,8 @@ public:
 class OrdersByDateReportStrategy : public ReportStrategy
 {
 public:
-    QString generateReport(const QList<Order> &orders,
+    using ReportStrategy::generateReport;
+    QString generateReport(const OrderColumns &orders,
                           const QList<Meal> &meals,
                           const QList<User> &users) override;
 };
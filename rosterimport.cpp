@@ -0,0 +1,153 @@
+#include "rosterimport.h"
+#include "user.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+// Разбивает строку CSV на поля с учетом кавычек (RFC 4180, без переносов внутри полей)
+QStringList splitCsvLine(const QString &line)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (qsizetype i = 0; i < line.size(); ++i) {
+        const QChar c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.append(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields.append(field);
+    return fields;
+}
+
+bool checkEntry(const RosterEntry &entry, QStringList *errors)
+{
+    if (entry.username.isEmpty() || entry.password.isEmpty()) {
+        errors->append(QString("Строка %1: не указан логин или пароль").arg(entry.line));
+        return false;
+    }
+    if (entry.balance.isNegative()) {
+        errors->append(QString("Строка %1: отрицательный баланс").arg(entry.line));
+        return false;
+    }
+    return true;
+}
+
+}
+
+QList<RosterEntry> RosterImport::readFile(const QString &filename, QStringList *errors)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errors->append("Не удалось открыть файл: " + file.errorString());
+        return {};
+    }
+    const QByteArray data = file.readAll();
+    if (QFileInfo(filename).suffix().compare("json", Qt::CaseInsensitive) == 0) {
+        return parseJson(data, errors);
+    }
+    return parseCsv(data, errors);
+}
+
+QList<RosterEntry> RosterImport::parseCsv(const QByteArray &data, QStringList *errors)
+{
+    QList<RosterEntry> entries;
+    QString text = QString::fromUtf8(data);
+    // Excel сохраняет CSV в UTF-8 с BOM - без этого заголовок не распознался бы
+    if (text.startsWith(QChar(0xFEFF))) {
+        text.remove(0, 1);
+    }
+    const QStringList lines = text.split('\n');
+    entries.reserve(lines.size());
+
+    for (qsizetype i = 0; i < lines.size(); ++i) {
+        // Строка целиком не обрезается: пробелы по краям пароля - часть пароля.
+        // Убирается только \r от переводов строк Windows
+        QString line = lines[i];
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        const QStringList fields = splitCsvLine(line);
+        // Необязательная строка заголовка
+        if (i == 0 && fields[0].trimmed().compare("username", Qt::CaseInsensitive) == 0) {
+            continue;
+        }
+
+        RosterEntry entry;
+        entry.line = int(i + 1);
+        entry.username = fields[0].trimmed();
+        entry.password = fields.value(1);
+        entry.balance = defaultBalance();
+        if (fields.size() > 2 && !fields[2].trimmed().isEmpty()) {
+            bool ok = false;
+            const double rubles = fields[2].trimmed().replace(',', '.').toDouble(&ok);
+            if (!ok) {
+                errors->append(QString("Строка %1: некорректный баланс").arg(entry.line));
+                continue;
+            }
+            entry.balance = Money::fromRubles(rubles);
+        }
+        if (checkEntry(entry, errors)) {
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+QList<RosterEntry> RosterImport::parseJson(const QByteArray &data, QStringList *errors)
+{
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    // Допускается как массив, так и объект {"students": [...]}
+    const QJsonArray array = doc.isArray() ? doc.array() : doc.object()["students"].toArray();
+    if (doc.isNull()) {
+        errors->append("Некорректный JSON: " + parseError.errorString());
+        return {};
+    }
+
+    QList<RosterEntry> entries;
+    entries.reserve(array.size());
+    for (qsizetype i = 0; i < array.size(); ++i) {
+        const QJsonObject obj = array[i].toObject();
+        RosterEntry entry;
+        entry.line = int(i + 1);
+        entry.username = obj["username"].toString().trimmed();
+        entry.password = obj["password"].toString();
+        entry.balance = obj.contains("balanceKopecks") || obj.contains("balance")
+                        ? Money::fromJson(obj, "balanceKopecks", "balance")
+                        : defaultBalance();
+        if (checkEntry(entry, errors)) {
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+void RosterImport::hashPasswords(QList<RosterEntry> &entries)
+{
+    QtConcurrent::blockingMap(entries, [](RosterEntry &entry) {
+        entry.password = User::hashPassword(entry.password);
+    });
+}
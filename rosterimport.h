@@ -0,0 +1,42 @@
+#ifndef ROSTERIMPORT_H
+#define ROSTERIMPORT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QByteArray>
+#include "money.h"
+
+// Строка списка учеников для массовой регистрации
+struct RosterEntry
+{
+    QString username;
+    QString password;   // после RosterImport::hashPasswords - SHA-256 в hex
+    Money balance;
+    int line = 0;       // номер строки/элемента в исходном файле, для сообщений
+};
+
+struct RosterImportResult
+{
+    int added = 0;
+    QStringList duplicates;   // логины, которые уже заняты или повторяются в файле
+    QStringList errors;
+};
+
+// Чтение списка учеников из CSV (username,password[,balance]) или JSON
+// (массив объектов {username, password, balance}) и подготовка к регистрации.
+// Баланс - в рублях; если не указан, берется начальный баланс при регистрации.
+class RosterImport
+{
+public:
+    static Money defaultBalance() { return Money::fromRubles(1000); }
+
+    static QList<RosterEntry> readFile(const QString &filename, QStringList *errors);
+    static QList<RosterEntry> parseCsv(const QByteArray &data, QStringList *errors);
+    static QList<RosterEntry> parseJson(const QByteArray &data, QStringList *errors);
+
+    // Хэширует пароли параллельно на всех ядрах (QtConcurrent)
+    static void hashPasswords(QList<RosterEntry> &entries);
+};
+
+#endif // ROSTERIMPORT_H
@@ -0,0 +1,35 @@
+#include "scratcharena.h"
+#include "perfstats.h"
+
+ScratchArena::ScratchArena()
+    : m_upstream(std::pmr::new_delete_resource())
+    , m_arena(m_initial, sizeof(m_initial), &m_upstream)
+    , m_front(&m_arena)
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    PERF_COUNT("ScratchArena.allocations", m_front.allocations);
+    PERF_COUNT("ScratchArena.bytes", m_front.bytes);
+    PERF_COUNT("ScratchArena.heapAllocations", m_upstream.allocations);
+}
+
+void *ScratchArena::CountingResource::do_allocate(std::size_t size, std::size_t alignment)
+{
+    void *p = next->allocate(size, alignment);
+    ++allocations;
+    bytes += qint64(size);
+    return p;
+}
+
+void ScratchArena::CountingResource::do_deallocate(void *p, std::size_t size, std::size_t alignment)
+{
+    // Для монотонной арены это пустая операция: память вернется в деструкторе
+    next->deallocate(p, size, alignment);
+}
+
+bool ScratchArena::CountingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
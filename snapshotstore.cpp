@@ -0,0 +1,164 @@
+#include "snapshotstore.h"
+#include "checksum.h"
+#include "filesync.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QDebug>
+
+namespace {
+
+const QByteArray TrailerPrefix = "#crc32c ";
+
+QByteArray checksumTrailer(const QByteArray &content)
+{
+    return TrailerPrefix + QByteArray::number(Checksum::crc32c(content), 16).rightJustified(8, '0') + '\n';
+}
+
+}
+
+SnapshotStore::SnapshotStore(const QString &path, int generations)
+    : m_path(path)
+    , m_generations(generations)
+{
+}
+
+void SnapshotStore::setPath(const QString &path)
+{
+    m_path = path;
+}
+
+QString SnapshotStore::generationPath(int generation) const
+{
+    return generation == 0 ? m_path : m_path + '.' + QString::number(generation);
+}
+
+bool SnapshotStore::hasAnyGeneration() const
+{
+    for (int generation = 0; generation <= m_generations; ++generation) {
+        if (QFile::exists(generationPath(generation))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SnapshotStore::write(const QByteArray &json, QString *errorMessage)
+{
+    QByteArray content = json;
+    if (!content.endsWith('\n')) {
+        content += '\n';
+    }
+    content += checksumTrailer(content);
+
+    // Новый снимок сначала целиком записывается рядом (<путь>.new). Поколения сдвигаются
+    // только после успешного commit(): сбой записи (например, нет места) не трогает целые копии.
+    const QString pending = m_path + ".new";
+    QSaveFile file(pending);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    if (file.write(content) != content.size() || !syncToDisk(file) || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        file.cancelWriting();
+        return false;
+    }
+
+    // Самое старое поколение удаляется, текущее становится .1. Если текущего нет
+    // (прошлое сохранение оборвалось после сдвига), сдвигать нечего: иначе
+    // единственная целая копия в .1 была бы вытеснена.
+    if (QFile::exists(m_path)) {
+        QFile::remove(generationPath(m_generations));
+        for (int generation = m_generations - 1; generation >= 0; --generation) {
+            const QString from = generationPath(generation);
+            if (QFile::exists(from)) {
+                QFile::rename(from, generationPath(generation + 1));
+            }
+        }
+    }
+    if (!QFile::rename(pending, m_path)) {
+        if (errorMessage) {
+            *errorMessage = QString("cannot rename %1 to %2").arg(pending, m_path);
+        }
+        return false;
+    }
+
+    // Переименование становится надежным только после fsync каталога
+    syncDirectory(QFileInfo(m_path).absolutePath());
+    return true;
+}
+
+bool SnapshotStore::load(QJsonObject *root, int *generation) const
+{
+    for (int candidate = 0; candidate <= m_generations; ++candidate) {
+        if (!QFile::exists(generationPath(candidate))) {
+            continue;
+        }
+        QString error;
+        if (readGeneration(candidate, root, &error)) {
+            if (generation) {
+                *generation = candidate;
+            }
+            return true;
+        }
+        qWarning() << "Snapshot:" << generationPath(candidate) << "is damaged:" << error;
+    }
+    return false;
+}
+
+bool SnapshotStore::readGeneration(int generation, QJsonObject *root, QString *errorMessage) const
+{
+    QFile file(generationPath(generation));
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorMessage = file.errorString();
+        return false;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+
+    // Контрольная сумма - последняя строка; в файлах старого формата ее нет
+    const int trailerStart = content.lastIndexOf('\n' + TrailerPrefix);
+    if (trailerStart >= 0) {
+        const QByteArray body = content.left(trailerStart + 1);
+        if (content.mid(trailerStart + 1) != checksumTrailer(body)) {
+            *errorMessage = "checksum mismatch";
+            return false;
+        }
+        content = body;
+    } else {
+        qInfo() << "Snapshot:" << generationPath(generation) << "has no checksum (old format)";
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(content, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        *errorMessage = parseError.errorString() + " at offset " + QString::number(parseError.offset);
+        return false;
+    }
+    if (!doc.isObject()) {
+        *errorMessage = "root is not an object";
+        return false;
+    }
+
+    *root = doc.object();
+    return true;
+}
+
+void SnapshotStore::quarantineNewerThan(int generation)
+{
+    for (int damaged = 0; damaged < generation; ++damaged) {
+        const QString from = generationPath(damaged);
+        if (QFile::exists(from)) {
+            const QString to = from + ".corrupt";
+            QFile::remove(to);
+            QFile::rename(from, to);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SNAPSHOTSTORE_H
+#define SNAPSHOTSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QJsonObject>
+
+// Полные снимки данных на диске с несколькими поколениями.
+// Снимок пишется атомарно (QSaveFile + fsync) в <путь>.new, и только после этого
+// предыдущие версии сдвигаются в файлы <путь>.1 ... <путь>.N. В конце снимка - строка с CRC32C содержимого;
+// при загрузке берется самое новое поколение, прошедшее проверку.
+class SnapshotStore
+{
+public:
+    static constexpr int DefaultGenerations = 3;
+
+    explicit SnapshotStore(const QString &path = QString(), int generations = DefaultGenerations);
+
+    void setPath(const QString &path);
+    const QString &path() const { return m_path; }
+    int generations() const { return m_generations; }
+    // 0 - текущий снимок, 1..generations() - предыдущие
+    QString generationPath(int generation) const;
+
+    bool hasAnyGeneration() const;
+
+    bool write(const QByteArray &json, QString *errorMessage = nullptr);
+    // Загружает самое новое целое поколение; номер поколения - в *generation.
+    // false - ни одно поколение не прошло проверку (или файлов нет).
+    bool load(QJsonObject *root, int *generation = nullptr) const;
+    // Убирает поколения новее generation (поврежденные) в файлы *.corrupt,
+    // чтобы следующее сохранение не вытеснило ими целые копии
+    void quarantineNewerThan(int generation);
+
+private:
+    bool readGeneration(int generation, QJsonObject *root, QString *errorMessage) const;
+
+    QString m_path;
+    int m_generations;
+};
+
+#endif // SNAPSHOTSTORE_H
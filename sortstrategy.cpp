@@ -1,36 +1,150 @@
 #include "sortstrategy.h"
+#include "perfstats.h"
+#include <QCollatorSortKey>
+#include <QLocale>
 #include <algorithm>
+#include <vector>
 
-QList<Meal> SortByNameStrategy::sort(const QList<Meal> &meals)
+namespace {
+
+std::vector<QCollatorSortKey> buildNameKeys(const QList<Meal> &meals, const QCollator &collator)
 {
-    QList<Meal> result = meals;
-    std::sort(result.begin(), result.end(), 
-              [](const Meal &a, const Meal &b) {
-                  return a.getName() < b.getName();
-              });
-    return result;
+    std::vector<QCollatorSortKey> keys;
+    keys.reserve(meals.size());
+    for (const Meal &meal : meals) {
+        keys.push_back(collator.sortKey(meal.getName()));
+    }
+    return keys;
 }
 
-QList<Meal> SortByPriceAscendingStrategy::sort(const QList<Meal> &meals)
+std::vector<qint64> buildPriceKeys(const QList<Meal> &meals)
 {
-    QList<Meal> result = meals;
-    std::sort(result.begin(), result.end(),
-              [](const Meal &a, const Meal &b) {
-                  return a.getPrice() < b.getPrice();
-              });
-    return result;
+    std::vector<qint64> keys;
+    keys.reserve(meals.size());
+    for (const Meal &meal : meals) {
+        keys.push_back(meal.getPrice().kopecks());
+    }
+    return keys;
+}
+
 }
 
-QList<Meal> SortByPriceDescendingStrategy::sort(const QList<Meal> &meals)
+SortStrategy::SortStrategy()
+    : m_cachedVersion(0)
+    , m_cachedSize(-1)
 {
-    QList<Meal> result = meals;
-    std::sort(result.begin(), result.end(),
-              [](const Meal &a, const Meal &b) {
-                  return a.getPrice() > b.getPrice();
-              });
+}
+
+QList<Meal> SortStrategy::sort(const QList<Meal> &meals)
+{
+    const QList<int> indices = sortIndices(meals);
+    QList<Meal> result;
+    result.reserve(meals.size());
+    for (int index : indices) {
+        result.append(meals[index]);
+    }
     return result;
 }
 
+QList<int> SortStrategy::sortIndices(const QList<Meal> &meals, quint64 dataVersion)
+{
+    if (dataVersion != 0 && dataVersion == m_cachedVersion && meals.size() == m_cachedSize) {
+        return m_cachedIndices;
+    }
+    
+    QList<int> indices(meals.size());
+    for (int i = 0; i < indices.size(); ++i) {
+        indices[i] = i;
+    }
+    sortPermutation(meals, indices);
+    
+    if (dataVersion != 0) {
+        m_cachedVersion = dataVersion;
+        m_cachedSize = meals.size();
+        m_cachedIndices = indices;
+    }
+    return indices;
+}
+
+QCollator SortStrategy::createNameCollator()
+{
+    // Меню на русском: сравниваем по правилам русской локали, без учета регистра
+    QCollator collator(QLocale(QLocale::Russian, QLocale::Russia));
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    collator.setNumericMode(true);
+    return collator;
+}
+
+void SortByNameStrategy::sortPermutation(const QList<Meal> &meals, QList<int> &indices)
+{
+    PERF_SCOPE("SortByNameStrategy::sort");
+    const std::vector<QCollatorSortKey> names = buildNameKeys(meals, createNameCollator());
+    std::stable_sort(indices.begin(), indices.end(),
+                     [&names](int a, int b) {
+                         return names[a].compare(names[b]) < 0;
+                     });
+}
+
+void SortByCategoryPriceNameStrategy::sortPermutation(const QList<Meal> &meals, QList<int> &indices)
+{
+    PERF_SCOPE("SortByCategoryPriceNameStrategy::sort");
+    const std::vector<qint64> prices = buildPriceKeys(meals);
+    const std::vector<QCollatorSortKey> names = buildNameKeys(meals, createNameCollator());
+    std::vector<int> categories;
+    categories.reserve(meals.size());
+    for (const Meal &meal : meals) {
+        categories.push_back(meal.getCategoryId());
+    }
+    
+    std::stable_sort(indices.begin(), indices.end(),
+                     [&](int a, int b) {
+                         if (categories[a] != categories[b]) {
+                             return categories[a] < categories[b];
+                         }
+                         if (prices[a] != prices[b]) {
+                             return prices[a] < prices[b];
+                         }
+                         return names[a].compare(names[b]) < 0;
+                     });
+}
+
+SortStrategyRegistry& SortStrategyRegistry::getInstance()
+{
+    static SortStrategyRegistry instance;
+    return instance;
+}
+
+SortStrategyRegistry::SortStrategyRegistry()
+{
+    add(0, "По названию", new SortByNameStrategy());
+    add(1, "По цене (возрастание)", new SortByPriceAscendingStrategy());
+    add(2, "По цене (убывание)", new SortByPriceDescendingStrategy());
+    add(3, "По категории и цене", new SortByCategoryPriceNameStrategy());
+    add(4, "По категории, сначала дорогие", new SortByCategoryPriceDescendingStrategy());
+}
+
+SortStrategyRegistry::~SortStrategyRegistry()
+{
+    for (const Entry &entry : m_entries) {
+        delete entry.strategy;
+    }
+}
+
+void SortStrategyRegistry::add(int id, const QString &title, SortStrategy *strategy)
+{
+    m_entries.append({id, title, strategy});
+}
+
+SortStrategy* SortStrategyRegistry::strategy(int id) const
+{
+    for (const Entry &entry : m_entries) {
+        if (entry.id == id) {
+            return entry.strategy;
+        }
+    }
+    return nullptr;
+}
+
 
 
 
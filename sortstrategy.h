@@ -2,31 +2,99 @@
 #define SORTSTRATEGY_H
 
 #include <QList>
+#include <QString>
+#include <QCollator>
+#include <algorithm>
 #include "meal.h"
+#include "composition.h"
 
 class SortStrategy
 {
 public:
+    SortStrategy();
     virtual ~SortStrategy() = default;
-    virtual QList<Meal> sort(const QList<Meal> &meals) = 0;
+    
+    QList<Meal> sort(const QList<Meal> &meals);
+    
+    // Возвращает перестановку индексов meals в отсортированном порядке.
+    // Если dataVersion != 0, результат кэшируется и переиспользуется,
+    // пока версия данных (DataManager::getMeals(&version)) не изменится.
+    QList<int> sortIndices(const QList<Meal> &meals, quint64 dataVersion = 0);
+    
+protected:
+    // Сортирует indices (изначально 0..n-1) по ключам, посчитанным один раз на блюдо
+    virtual void sortPermutation(const QList<Meal> &meals, QList<int> &indices) = 0;
+    
+    static QCollator createNameCollator();
+    
+private:
+    quint64 m_cachedVersion;
+    qsizetype m_cachedSize;
+    QList<int> m_cachedIndices;
 };
 
 class SortByNameStrategy : public SortStrategy
 {
-public:
-    QList<Meal> sort(const QList<Meal> &meals) override;
+protected:
+    void sortPermutation(const QList<Meal> &meals, QList<int> &indices) override;
 };
 
-class SortByPriceAscendingStrategy : public SortStrategy
+// Стратегия на основе составного компаратора из composition.h.
+// Виртуальный вызов - один на сортировку, сравнения встраиваются.
+template <typename Comparator>
+class ComposedSortStrategy : public SortStrategy
 {
-public:
-    QList<Meal> sort(const QList<Meal> &meals) override;
+protected:
+    void sortPermutation(const QList<Meal> &meals, QList<int> &indices) override
+    {
+        const Comparator comparator{};
+        std::stable_sort(indices.begin(), indices.end(),
+                         [&meals, &comparator](int a, int b) {
+                             return comparator(meals[a], meals[b]);
+                         });
+    }
+};
+
+using SortByPriceAscendingStrategy =
+    ComposedSortStrategy<decltype(compose::by<&Meal::getPrice>())>;
+using SortByPriceDescendingStrategy =
+    ComposedSortStrategy<decltype(compose::by<&Meal::getPrice>(compose::desc))>;
+using SortByCategoryPriceDescendingStrategy =
+    ComposedSortStrategy<decltype(compose::by<&Meal::getCategoryId>().then<&Meal::getPrice>(compose::desc))>;
+
+// Категория, затем цена, затем название
+class SortByCategoryPriceNameStrategy : public SortStrategy
+{
+protected:
+    void sortPermutation(const QList<Meal> &meals, QList<int> &indices) override;
 };
 
-class SortByPriceDescendingStrategy : public SortStrategy
+// Выбор стратегии по идентификатору из комбобокса. Стратегии создаются один раз
+// и принадлежат реестру, окна хранят только указатель.
+class SortStrategyRegistry
 {
 public:
-    QList<Meal> sort(const QList<Meal> &meals) override;
+    struct Entry
+    {
+        int id;
+        QString title;
+        SortStrategy *strategy;
+    };
+    
+    static SortStrategyRegistry& getInstance();
+    
+    const QList<Entry>& entries() const { return m_entries; }
+    SortStrategy* strategy(int id) const;
+    
+private:
+    SortStrategyRegistry();
+    ~SortStrategyRegistry();
+    SortStrategyRegistry(const SortStrategyRegistry&) = delete;
+    SortStrategyRegistry& operator=(const SortStrategyRegistry&) = delete;
+    
+    void add(int id, const QString &title, SortStrategy *strategy);
+    
+    QList<Entry> m_entries;
 };
 
 #endif // SORTSTRATEGY_H
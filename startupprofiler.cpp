@@ -0,0 +1,55 @@
+#include "startupprofiler.h"
+#include "perfstats.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QWidget>
+#include <QDebug>
+
+namespace StartupProfiler {
+
+namespace {
+
+QElapsedTimer &timer()
+{
+    static QElapsedTimer instance;
+    return instance;
+}
+
+qint64 previousMarkMs = 0;
+
+}
+
+void start()
+{
+    timer().start();
+}
+
+qint64 elapsedMs()
+{
+    return timer().isValid() ? timer().elapsed() : 0;
+}
+
+void mark(const char *stage)
+{
+    const qint64 elapsed = elapsedMs();
+    const qint64 sincePrevious = elapsed - previousMarkMs;
+    previousMarkMs = elapsed;
+    qInfo().noquote() << "Startup:" << stage << "after" << elapsed << "ms (+" << sincePrevious << "ms)";
+    if (PerfStats::isEnabled()) {
+        PerfStats::record(PerfStats::registerSite(stage), sincePrevious * 1000000);
+    }
+}
+
+void markFirstFrame(QWidget *window, const char *stage, std::function<void()> then)
+{
+    // Таймер с нулевым интервалом срабатывает после уже поставленных в очередь событий,
+    // в том числе отрисовки после show()
+    QTimer::singleShot(0, window, [stage, then = std::move(then)]() {
+        mark(stage);
+        if (then) {
+            then();
+        }
+    });
+}
+
+}
@@ -0,0 +1,25 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QtGlobal>
+#include <functional>
+
+class QWidget;
+
+// Замер холодного старта: время от начала main до этапов запуска и до первого
+// интерактивного кадра окна (окно показано, очередь событий после отрисовки пуста).
+// Этапы пишутся в лог ("Startup: ...") и в PerfStats под своими именами.
+namespace StartupProfiler {
+
+// Вызывается первой строкой main
+void start();
+qint64 elapsedMs();
+// Пишет время от старта и от предыдущего этапа; в PerfStats попадает второе
+void mark(const char *stage);
+
+// Отмечает stage, когда показанное окно отрисовано и готово к вводу; затем вызывает then
+void markFirstFrame(QWidget *window, const char *stage, std::function<void()> then = {});
+
+}
+
+#endif // STARTUPPROFILER_H
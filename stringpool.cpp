@@ -0,0 +1,50 @@
+#include "stringpool.h"
+
+StringPool &StringPool::global()
+{
+    static StringPool instance;
+    return instance;
+}
+
+QString StringPool::intern(const QString &value)
+{
+    if (value.isEmpty()) {
+        return value;
+    }
+    QMutexLocker locker(&m_mutex);
+    auto it = m_strings.constFind(value);
+    if (it != m_strings.cend()) {
+        return *it;
+    }
+    // В пул кладется точная по размеру копия, чтобы не держать запас емкости исходной строки
+    QString stored = value.capacity() > value.size() ? QString(value.constData(), value.size()) : value;
+    m_strings.insert(stored);
+    return stored;
+}
+
+qsizetype StringPool::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_strings.size();
+}
+
+qsizetype StringPool::prune()
+{
+    QMutexLocker locker(&m_mutex);
+    const qsizetype before = m_strings.size();
+    for (auto it = m_strings.begin(); it != m_strings.end();) {
+        // Единственная ссылка на данные - копия в пуле
+        if (it->isDetached()) {
+            it = m_strings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return before - m_strings.size();
+}
+
+void StringPool::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_strings.clear();
+}
@@ -0,0 +1,37 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+
+// Пул строк для повторяющихся значений: названий блюд и категорий, путей к картинкам, логинов.
+// intern() возвращает копию строки из пула - она разделяет данные (implicit sharing) со всеми
+// прочими копиями, поэтому одинаковые значения занимают память один раз, а строки из пула
+// можно сравнивать по указателю на данные (equal). Потокобезопасен.
+// Пул сам не уменьшается: строки, которые больше никто не держит (после перезагрузки,
+// переименования блюд, отмененного импорта), убирает prune().
+class StringPool
+{
+public:
+    static StringPool &global();
+
+    QString intern(const QString &value);
+
+    // Сравнение с быстрым путем для строк из одного пула
+    static bool equal(const QString &a, const QString &b)
+    {
+        return (a.constData() == b.constData() && a.size() == b.size()) || a == b;
+    }
+
+    qsizetype size() const;
+    // Удаляет строки, на которые ссылается только пул; возвращает число удаленных
+    qsizetype prune();
+    void clear();
+
+private:
+    mutable QMutex m_mutex;
+    QSet<QString> m_strings;
+};
+
+#endif // STRINGPOOL_H
@@ -4,6 +4,9 @@
 #include "meal.h"
 #include "category.h"
 #include "sortstrategy.h"
+#include "orderserviceclient.h"
+#include "composition.h"
+#include "perfstats.h"
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QDate>
@@ -21,12 +24,11 @@ StudentWindow::StudentWindow(User *user, QWidget *parent)
     , m_user(user)
     , m_orderObserver(new OrderObserver(this))
     , m_sortStrategy(nullptr)
+    , m_orderClient(nullptr)
 {
     setWindowTitle("Столовая - " + user->getUsername());
     setupUI();
-    refreshMeals();
-    updateBalance();
-    refreshOrders();
+    ensureTabLoaded(m_tabWidget->currentIndex());
     
     connect(m_orderObserver, &OrderObserver::balanceUpdated, this, &StudentWindow::onBalanceUpdated);
     
@@ -35,7 +37,11 @@ StudentWindow::StudentWindow(User *user, QWidget *parent)
 
 StudentWindow::~StudentWindow()
 {
-    delete m_sortStrategy;
+}
+
+void StudentWindow::setOrderServiceClient(OrderServiceClient *client)
+{
+    m_orderClient = client;
 }
 
 void StudentWindow::closeEvent(QCloseEvent *event)
@@ -49,15 +55,36 @@ void StudentWindow::setupUI()
     m_tabWidget = new QTabWidget(this);
     setCentralWidget(m_tabWidget);
     
-    setupMenuTab();
-    setupOrdersTab();
+    // Вкладки заполняются и загружают данные при первом показе (ensureTabLoaded)
+    m_menuTab = new QWidget();
+    m_ordersTab = new QWidget();
+    m_tabWidget->addTab(m_menuTab, "Меню и заказ");
+    m_tabWidget->addTab(m_ordersTab, "Мои заказы");
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, &StudentWindow::ensureTabLoaded);
     
     resize(900, 650);
 }
 
+void StudentWindow::ensureTabLoaded(int index)
+{
+    QWidget *tab = m_tabWidget->widget(index);
+    if (!tab || m_loadedTabs.contains(tab)) {
+        return;
+    }
+    m_loadedTabs.insert(tab);
+    
+    if (tab == m_menuTab) {
+        setupMenuTab();
+        refreshMeals();
+        updateBalance();
+    } else if (tab == m_ordersTab) {
+        setupOrdersTab();
+        refreshOrders();
+    }
+}
+
 void StudentWindow::setupMenuTab()
 {
-    m_menuTab = new QWidget();
     QVBoxLayout *mainLayout = new QVBoxLayout(m_menuTab);
     
     // Баланс
@@ -94,9 +121,9 @@ void StudentWindow::setupMenuTab()
     
     searchLayout->addWidget(new QLabel("Сортировка:"));
     m_sortCombo = new QComboBox();
-    m_sortCombo->addItem("По названию", 0);
-    m_sortCombo->addItem("По цене (возрастание)", 1);
-    m_sortCombo->addItem("По цене (убывание)", 2);
+    for (const SortStrategyRegistry::Entry &entry : SortStrategyRegistry::getInstance().entries()) {
+        m_sortCombo->addItem(entry.title, entry.id);
+    }
     searchLayout->addWidget(m_sortCombo);
     
     mainLayout->addLayout(searchLayout);
@@ -160,13 +187,10 @@ void StudentWindow::setupMenuTab()
     
     connect(m_removeFromCartButton, &QPushButton::clicked, this, &StudentWindow::onRemoveFromCart);
     connect(m_placeOrderButton, &QPushButton::clicked, this, &StudentWindow::onPlaceOrder);
-    
-    m_tabWidget->addTab(m_menuTab, "Меню и заказ");
 }
 
 void StudentWindow::setupOrdersTab()
 {
-    m_ordersTab = new QWidget();
     QVBoxLayout *mainLayout = new QVBoxLayout(m_ordersTab);
     
     QLabel *titleLabel = new QLabel("Мои заказы:");
@@ -197,8 +221,6 @@ void StudentWindow::setupOrdersTab()
     
     connect(m_filterDateEdit, &QDateEdit::dateChanged, this, &StudentWindow::onFilterOrders);
     connect(m_clearFilterButton, &QPushButton::clicked, this, &StudentWindow::refreshOrders);
-    
-    m_tabWidget->addTab(m_ordersTab, "Мои заказы");
 }
 
 void StudentWindow::loadCategories()
@@ -214,23 +236,41 @@ void StudentWindow::loadCategories()
 
 void StudentWindow::refreshMeals()
 {
-    DataManager &dm = DataManager::getInstance();
-    QList<Meal> meals = dm.getMeals();
-    
-    // Применяем сортировку
+    PERF_SCOPE("StudentWindow::refreshMeals");
+    quint64 version = 0;
+    const QList<Meal> meals = DataManager::getInstance().getMeals(&version);
+    fillMealsTable(meals, sortedMealIndices(meals, version));
+}
+
+QList<int> StudentWindow::sortedMealIndices(const QList<Meal> &meals, quint64 mealsVersion)
+{
+    PERF_SCOPE("StudentWindow::sortedMealIndices");
+    // Сортируем индексы, а не сами блюда; для полного меню результат кэшируется по версии данных
     if (m_sortStrategy) {
-        meals = m_sortStrategy->sort(meals);
+        return m_sortStrategy->sortIndices(meals, mealsVersion);
     }
     
-    m_mealsTable->setRowCount(meals.size());
+    QList<int> indices(meals.size());
+    for (int i = 0; i < indices.size(); ++i) {
+        indices[i] = i;
+    }
+    return indices;
+}
+
+void StudentWindow::fillMealsTable(const QList<Meal> &meals, const QList<int> &indices)
+{
+    PERF_SCOPE("StudentWindow::fillMealsTable");
+    DataManager &dm = DataManager::getInstance();
+    m_mealsTable->setRowCount(indices.size());
     
-    for (int i = 0; i < meals.size(); ++i) {
-        const Meal &meal = meals[i];
+    for (int i = 0; i < indices.size(); ++i) {
+        const Meal &meal = meals[indices[i]];
         
         // Фото блюда
         QTableWidgetItem *photoItem = new QTableWidgetItem();
         photoItem->setFlags(photoItem->flags() & ~Qt::ItemIsEditable);
         if (!meal.getImagePath().isEmpty() && QFileInfo::exists(meal.getImagePath())) {
+            PERF_SCOPE("StudentWindow::loadMealPixmap");
             QPixmap pixmap(meal.getImagePath());
             if (!pixmap.isNull()) {
                 pixmap = pixmap.scaled(70, 70, Qt::KeepAspectRatio, Qt::SmoothTransformation);
@@ -243,9 +283,9 @@ void StudentWindow::refreshMeals()
         nameItem->setData(Qt::UserRole, meal.getId());
         m_mealsTable->setItem(i, 1, nameItem);
         
-        m_mealsTable->setItem(i, 2, new QTableWidgetItem(QString::number(meal.getPrice(), 'f', 2) + " руб."));
+        m_mealsTable->setItem(i, 2, new QTableWidgetItem(meal.getPrice().toString() + " руб."));
         
-        Category *cat = dm.getCategoryById(meal.getCategoryId());
+        std::optional<Category> cat = dm.getCategoryById(meal.getCategoryId());
         QString catName = cat ? cat->getName() : "Неизвестно";
         m_mealsTable->setItem(i, 3, new QTableWidgetItem(catName));
     }
@@ -253,6 +293,7 @@ void StudentWindow::refreshMeals()
 
 void StudentWindow::refreshCart()
 {
+    PERF_SCOPE("StudentWindow::refreshCart");
     DataManager &dm = DataManager::getInstance();
     m_cartTable->setRowCount(m_cart.size());
     
@@ -260,7 +301,7 @@ void StudentWindow::refreshCart()
         int mealId = m_cart[i].first;
         int quantity = m_cart[i].second;
         
-        Meal *meal = dm.getMealById(mealId);
+        std::optional<Meal> meal = dm.getMealById(mealId);
         if (meal) {
             // Фото блюда
             QTableWidgetItem *photoItem = new QTableWidgetItem();
@@ -278,7 +319,7 @@ void StudentWindow::refreshCart()
             nameItem->setData(Qt::UserRole, mealId);
             m_cartTable->setItem(i, 1, nameItem);
             
-            m_cartTable->setItem(i, 2, new QTableWidgetItem(QString::number(meal->getPrice(), 'f', 2) + " руб."));
+            m_cartTable->setItem(i, 2, new QTableWidgetItem(meal->getPrice().toString() + " руб."));
             m_cartTable->setItem(i, 3, new QTableWidgetItem(QString::number(quantity)));
         }
     }
@@ -286,12 +327,17 @@ void StudentWindow::refreshCart()
     m_cartTable->setColumnWidth(0, 80);
     m_cartTable->setColumnWidth(1, 250);
     
-    double total = calculateCartTotal();
-    m_totalLabel->setText(QString("Итого: %1 руб.").arg(total, 0, 'f', 2));
+    Money total = calculateCartTotal();
+    m_totalLabel->setText(QString("Итого: %1 руб.").arg(total.toString()));
 }
 
 void StudentWindow::refreshOrders()
 {
+    // Вкладка еще не открывалась - заказы загрузятся при первом показе
+    if (!m_loadedTabs.contains(m_ordersTab)) {
+        return;
+    }
+    
     // Устанавливаем сегодняшнюю дату при нажатии "Очистить"
     m_filterDateEdit->setDate(QDate::currentDate());
     onFilterOrders();
@@ -299,6 +345,7 @@ void StudentWindow::refreshOrders()
 
 void StudentWindow::onFilterOrders()
 {
+    PERF_SCOPE("StudentWindow::onFilterOrders");
     DataManager &dm = DataManager::getInstance();
     QList<Order> orders = dm.getOrdersByUserId(m_user->getId());
     
@@ -328,7 +375,7 @@ void StudentWindow::onFilterOrders()
         
         QString mealsStr;
         for (const auto &mealPair : order.getMeals()) {
-            Meal *meal = dm.getMealById(mealPair.first);
+            std::optional<Meal> meal = dm.getMealById(mealPair.first);
             if (meal) {
                 mealsStr += QString("%1 (x%2), ").arg(meal->getName()).arg(mealPair.second);
             }
@@ -337,7 +384,7 @@ void StudentWindow::onFilterOrders()
             mealsStr.chop(2);
         }
         m_myOrdersTable->setItem(i, 2, new QTableWidgetItem(mealsStr));
-        m_myOrdersTable->setItem(i, 3, new QTableWidgetItem(QString::number(order.getTotalPrice(), 'f', 2) + " руб."));
+        m_myOrdersTable->setItem(i, 3, new QTableWidgetItem(order.getTotalPrice().toString() + " руб."));
     }
     
     m_myOrdersTable->setColumnWidth(2, 300);
@@ -355,13 +402,13 @@ int StudentWindow::getSelectedMealId()
     return -1;
 }
 
-double StudentWindow::calculateCartTotal()
+Money StudentWindow::calculateCartTotal()
 {
     DataManager &dm = DataManager::getInstance();
-    double total = 0.0;
+    Money total;
     
     for (const auto &item : m_cart) {
-        Meal *meal = dm.getMealById(item.first);
+        std::optional<Meal> meal = dm.getMealById(item.first);
         if (meal) {
             total += meal->getPrice() * item.second;
         }
@@ -372,10 +419,10 @@ double StudentWindow::calculateCartTotal()
 
 void StudentWindow::updateBalance()
 {
-    m_balanceLabel->setText(QString("Ваш баланс: %1 руб.").arg(m_user->getBalance(), 0, 'f', 2));
+    m_balanceLabel->setText(QString("Ваш баланс: %1 руб.").arg(m_user->getBalance().toString()));
 }
 
-void StudentWindow::onBalanceUpdated(int userId, double newBalance)
+void StudentWindow::onBalanceUpdated(int userId, Money newBalance)
 {
     if (userId == m_user->getId()) {
         m_user->setBalance(newBalance);
@@ -385,105 +432,45 @@ void StudentWindow::onBalanceUpdated(int userId, double newBalance)
 
 void StudentWindow::onSearchMeals()
 {
+    PERF_SCOPE("StudentWindow::onSearchMeals");
     QString searchText = m_searchEdit->text().trimmed().toLower();
-    DataManager &dm = DataManager::getInstance();
-    QList<Meal> allMeals = dm.getMeals();
-    QList<Meal> filtered;
+    quint64 version = 0;
+    const QList<Meal> allMeals = DataManager::getInstance().getMeals(&version);
+    QList<int> filtered;
     
-    for (const Meal &meal : allMeals) {
-        if (searchText.isEmpty() || meal.getName().toLower().contains(searchText)) {
-            filtered.append(meal);
+    for (int index : sortedMealIndices(allMeals, version)) {
+        if (searchText.isEmpty() || allMeals[index].getName().toLower().contains(searchText)) {
+            filtered.append(index);
         }
     }
     
-    if (m_sortStrategy) {
-        filtered = m_sortStrategy->sort(filtered);
-    }
-    
-    m_mealsTable->setRowCount(filtered.size());
-    
-    for (int i = 0; i < filtered.size(); ++i) {
-        const Meal &meal = filtered[i];
-        
-        QTableWidgetItem *photoItem = new QTableWidgetItem();
-        photoItem->setFlags(photoItem->flags() & ~Qt::ItemIsEditable);
-        if (!meal.getImagePath().isEmpty() && QFileInfo::exists(meal.getImagePath())) {
-            QPixmap pixmap(meal.getImagePath());
-            if (!pixmap.isNull()) {
-                pixmap = pixmap.scaled(70, 70, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                photoItem->setData(Qt::DecorationRole, pixmap);
-            }
-        }
-        m_mealsTable->setItem(i, 0, photoItem);
-        
-        QTableWidgetItem *nameItem = new QTableWidgetItem(meal.getName());
-        nameItem->setData(Qt::UserRole, meal.getId());
-        m_mealsTable->setItem(i, 1, nameItem);
-        
-        m_mealsTable->setItem(i, 2, new QTableWidgetItem(QString::number(meal.getPrice(), 'f', 2) + " руб."));
-        
-        Category *cat = dm.getCategoryById(meal.getCategoryId());
-        QString catName = cat ? cat->getName() : "Неизвестно";
-        m_mealsTable->setItem(i, 3, new QTableWidgetItem(catName));
-    }
+    fillMealsTable(allMeals, filtered);
 }
 
 void StudentWindow::onFilterByCategory()
 {
-    DataManager &dm = DataManager::getInstance();
-    QList<Meal> allMeals = dm.getMeals();
-    QList<Meal> filtered;
+    quint64 version = 0;
+    const QList<Meal> allMeals = DataManager::getInstance().getMeals(&version);
+    QList<int> filtered;
     
     int categoryId = m_categoryFilterCombo->currentData().toInt();
-    double maxPrice = m_priceFilterCombo->currentData().toDouble();
-    
-    for (const Meal &meal : allMeals) {
-        bool matches = true;
-        
-        if (categoryId != -1 && meal.getCategoryId() != categoryId) {
-            matches = false;
-        }
-        
-        if (maxPrice != -1 && meal.getPrice() > maxPrice) {
-            matches = false;
-        }
-        
-        if (matches) {
-            filtered.append(meal);
+    int maxPrice = m_priceFilterCombo->currentData().toInt();
+    
+    const auto matches =
+        compose::where<&Meal::getCategoryId>([categoryId](int id) {
+            return categoryId == -1 || id == categoryId;
+        })
+        && compose::where<&Meal::getPrice>([maxPrice](Money price) {
+            return maxPrice == -1 || price <= Money::fromRubles(maxPrice);
+        });
+    
+    for (int index : sortedMealIndices(allMeals, version)) {
+        if (matches(allMeals[index])) {
+            filtered.append(index);
         }
     }
     
-    if (m_sortStrategy) {
-        filtered = m_sortStrategy->sort(filtered);
-    }
-    
-    m_mealsTable->setRowCount(filtered.size());
-    
-    for (int i = 0; i < filtered.size(); ++i) {
-        const Meal &meal = filtered[i];
-        
-        // Фото блюда
-        QTableWidgetItem *photoItem = new QTableWidgetItem();
-        photoItem->setFlags(photoItem->flags() & ~Qt::ItemIsEditable);
-        if (!meal.getImagePath().isEmpty() && QFileInfo::exists(meal.getImagePath())) {
-            QPixmap pixmap(meal.getImagePath());
-            if (!pixmap.isNull()) {
-                pixmap = pixmap.scaled(70, 70, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                photoItem->setData(Qt::DecorationRole, pixmap);
-            }
-        }
-        m_mealsTable->setItem(i, 0, photoItem);
-        
-        QTableWidgetItem *nameItem = new QTableWidgetItem(meal.getName());
-        nameItem->setData(Qt::UserRole, meal.getId());
-        m_mealsTable->setItem(i, 1, nameItem);
-        
-        m_mealsTable->setItem(i, 2, new QTableWidgetItem(QString::number(meal.getPrice(), 'f', 2) + " руб."));
-        
-        Category *cat = dm.getCategoryById(meal.getCategoryId());
-        QString catName = cat ? cat->getName() : "Неизвестно";
-        m_mealsTable->setItem(i, 3, new QTableWidgetItem(catName));
-    }
+    fillMealsTable(allMeals, filtered);
 }
 
 void StudentWindow::onAddToCart()
@@ -551,28 +538,42 @@ void StudentWindow::onPlaceOrder()
         return;
     }
     
-    double total = calculateCartTotal();
+    Money total = calculateCartTotal();
     
     if (m_user->getBalance() < total) {
         QMessageBox::warning(this, "Ошибка", QString("Недостаточно средств. Необходимо: %1 руб., у вас: %2 руб.")
-                            .arg(total, 0, 'f', 2)
-                            .arg(m_user->getBalance(), 0, 'f', 2));
+                            .arg(total.toString())
+                            .arg(m_user->getBalance().toString()));
         return;
     }
     
     int ret = QMessageBox::question(this, "Подтверждение заказа",
-                                    QString("Оформить заказ на сумму %1 руб.?").arg(total, 0, 'f', 2),
+                                    QString("Оформить заказ на сумму %1 руб.?").arg(total.toString()),
                                     QMessageBox::Yes | QMessageBox::No);
     if (ret == QMessageBox::Yes) {
         DataManager &dm = DataManager::getInstance();
-        Order order(dm.getNextOrderId(), m_user->getId(), QDate::currentDate(), m_cart);
-        order.setTotalPrice(total);
+        QString error;
+        bool placed;
+        if (m_orderClient) {
+            // Заказ фиксирует сервис; затем перечитываем общие данные
+            placed = m_orderClient->placeOrder(m_user->getId(), m_cart, &error);
+            if (placed) {
+                dm.loadData();
+                refreshMeals();
+            }
+        } else {
+            placed = dm.placeOrder(m_user->getId(), m_cart, &error).has_value();
+        }
+        if (!placed) {
+            QMessageBox::warning(this, "Ошибка", error);
+            return;
+        }
         
         // Используем Observer для баланса
-        m_orderObserver->notifyOrderPlaced(&order, m_user, total);
-        
-        dm.addOrder(order);
-        dm.updateUser(*m_user);
+        std::optional<User> user = dm.getUserById(m_user->getId());
+        if (user) {
+            m_orderObserver->notifyOrderPlaced(*user);
+        }
         
         m_cart.clear();
         refreshCart();
@@ -585,22 +586,8 @@ void StudentWindow::onPlaceOrder()
 
 void StudentWindow::onSortMealsChanged()
 {
-    int index = m_sortCombo->currentData().toInt();
-    delete m_sortStrategy;
-    
-    switch (index) {
-    case 0:
-        m_sortStrategy = new SortByNameStrategy();
-        break;
-    case 1:
-        m_sortStrategy = new SortByPriceAscendingStrategy();
-        break;
-    case 2:
-        m_sortStrategy = new SortByPriceDescendingStrategy();
-        break;
-    default:
-        m_sortStrategy = nullptr;
-    }
+    int id = m_sortCombo->currentData().toInt();
+    m_sortStrategy = SortStrategyRegistry::getInstance().strategy(id);
     
     refreshMeals();
 }
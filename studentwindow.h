@@ -16,10 +16,13 @@
 #include <QAbstractItemView>
 #include <QHeaderView>
 #include <QCloseEvent>
+#include <QSet>
 #include "user.h"
 #include "orderobserver.h"
 #include "sortstrategy.h"
 
+class OrderServiceClient;
+
 class StudentWindow : public QMainWindow
 {
     Q_OBJECT
@@ -27,6 +30,9 @@ class StudentWindow : public QMainWindow
 public:
     explicit StudentWindow(User *user, QWidget *parent = nullptr);
     ~StudentWindow();
+    
+    // Клиентский режим: заказы оформляются через сервис заказов
+    void setOrderServiceClient(OrderServiceClient *client);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
@@ -43,13 +49,15 @@ private slots:
     void refreshOrders();
     void onFilterOrders();
     void updateBalance();
-    void onBalanceUpdated(int userId, double newBalance);
+    void onBalanceUpdated(int userId, Money newBalance);
     void onSortMealsChanged();
+    void ensureTabLoaded(int index);
 
 private:
     User *m_user;
     OrderObserver *m_orderObserver;
     SortStrategy *m_sortStrategy;
+    OrderServiceClient *m_orderClient;
     
     QTabWidget *m_tabWidget;
     
@@ -74,13 +82,17 @@ private:
     QPushButton *m_clearFilterButton;
     
     QList<QPair<int, int>> m_cart;
+    QSet<QWidget *> m_loadedTabs;
     
     void setupUI();
     void setupMenuTab();
     void setupOrdersTab();
     void loadCategories();
+    // mealsVersion - версия, полученная вместе с meals (DataManager::getMeals)
+    QList<int> sortedMealIndices(const QList<Meal> &meals, quint64 mealsVersion);
+    void fillMealsTable(const QList<Meal> &meals, const QList<int> &indices);
     int getSelectedMealId();
-    double calculateCartTotal();
+    Money calculateCartTotal();
 };
 
 #endif // STUDENTWINDOW_H
@@ -0,0 +1,78 @@
+// Векторные пути ядер агрегации должны давать те же результаты, что и скалярный:
+// на длинах, не кратных ширине вектора, с невыровненным началом массива
+// и с пропускаемыми значениями (OrderColumns::InvalidDay) в любых позициях.
+#include "aggregationkernels.h"
+#include "ordercolumns.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace AggregationKernels;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char *what, Isa isa, qsizetype n, qsizetype offset)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s (%s, n=%lld, offset=%lld)\n", what, isaName(isa),
+                     static_cast<long long>(n), static_cast<long long>(offset));
+        ++failures;
+    }
+}
+
+}
+
+int main()
+{
+    std::mt19937 rng(20240901);
+    const std::vector<qsizetype> lengths = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 1000, 1003 };
+    constexpr qsizetype MaxOffset = 3;
+    
+    int tested = 0;
+    for (Isa isa : { Isa::Sse41, Isa::Avx2 }) {
+        if (!isaSupported(isa)) {
+            std::printf("%s: not supported, skipped\n", isaName(isa));
+            continue;
+        }
+        ++tested;
+        for (qsizetype n : lengths) {
+            for (qsizetype offset = 0; offset <= MaxOffset; ++offset) {
+                // Суммы в копейках, в том числе отрицательные (возвраты)
+                std::vector<qint64> totals(n + MaxOffset);
+                std::uniform_int_distribution<qint64> kopecks(-(qint64(1) << 40), qint64(1) << 40);
+                for (qint64 &value : totals) {
+                    value = kopecks(rng);
+                }
+                check(sum(isa, totals.data() + offset, n) == sum(Isa::Scalar, totals.data() + offset, n),
+                      "sum", isa, n, offset);
+                
+                // Дни заказов; каждый пятый в среднем - InvalidDay, иногда все
+                std::vector<qint32> days(n + MaxOffset);
+                std::uniform_int_distribution<qint32> day(2450000, 2470000);
+                const bool allInvalid = rng() % 8 == 0;
+                for (qint32 &value : days) {
+                    value = allInvalid || rng() % 5 == 0 ? OrderColumns::InvalidDay : day(rng);
+                }
+                qint32 vectorMin = 0;
+                qint32 vectorMax = 0;
+                qint32 scalarMin = 0;
+                qint32 scalarMax = 0;
+                const bool vectorFound = minMax(isa, days.data() + offset, n, OrderColumns::InvalidDay,
+                                                &vectorMin, &vectorMax);
+                const bool scalarFound = minMax(Isa::Scalar, days.data() + offset, n, OrderColumns::InvalidDay,
+                                                &scalarMin, &scalarMax);
+                check(vectorFound == scalarFound, "minMax found", isa, n, offset);
+                check(vectorMin == scalarMin && vectorMax == scalarMax, "minMax bounds", isa, n, offset);
+            }
+        }
+    }
+    
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("OK, %d vector path(s) checked against scalar\n", tested);
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Нагрузочный тест блокировок DataManager: несколько потоков оформляют заказы, другие
+// читают выборки и строят отчеты, еще один сохраняет данные и меняет меню.
+// В конце проверяется, что ни один заказ и ни одно списание не потерялись, в том числе
+// после сохранения и повторной загрузки. Гонки ищет сборка с -DCANTEEN_SANITIZE_THREAD=ON.
+// Отдельно проверяется перезапуск, когда индекс месяцев не удается записать: заказы журнала,
+// уже лежащие в файле месяца, не должны повториться.
+#include "datamanager.h"
+#include "reportmanager.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr int WriterThreads = 4;
+constexpr int ReaderThreads = 4;
+constexpr int OrdersPerWriter = 150;
+constexpr qint64 PriceKopecks = 5000;
+
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dataDir;
+    if (!dataDir.isValid()) {
+        std::fprintf(stderr, "cannot create a temporary data directory\n");
+        return 1;
+    }
+    DataManager::setDataDirectory(dataDir.path());
+    DataManager &dm = DataManager::getInstance();
+
+    const int mealId = dm.getNextMealId();
+    dm.addMeal(Meal(mealId, "Каша", Money::fromKopecks(PriceKopecks), 1));
+    // Баланса хватает ровно на OrdersPerWriter заказов
+    QList<int> students;
+    for (int i = 0; i < WriterThreads; ++i) {
+        const int userId = dm.getNextUserId();
+        dm.addUser(User(userId, QString("student%1").arg(i), User::hashPassword("1"), UserType::Student,
+                        Money::fromKopecks(PriceKopecks * OrdersPerWriter)));
+        students.append(userId);
+    }
+
+    std::atomic<int> placed{0};
+    std::atomic<int> writersLeft{WriterThreads};
+    std::atomic<bool> readerFailed{false};
+    std::vector<std::unique_ptr<QThread>> threads;
+
+    for (int w = 0; w < WriterThreads; ++w) {
+        const int userId = students[w];
+        threads.emplace_back(QThread::create([&dm, &placed, &writersLeft, userId, mealId]() {
+            for (int i = 0; i < OrdersPerWriter; ++i) {
+                if (dm.placeOrder(userId, { qMakePair(mealId, 1) })) {
+                    ++placed;
+                }
+            }
+            --writersLeft;
+        }));
+    }
+
+    for (int r = 0; r < ReaderThreads; ++r) {
+        const int userId = students[r % students.size()];
+        threads.emplace_back(QThread::create([&dm, &writersLeft, &readerFailed, userId]() {
+            ReportManager reports;
+            qsizetype seen = 0;
+            while (writersLeft.load() > 0) {
+                // Заказы пользователя только добавляются
+                const qsizetype count = dm.getOrdersByUserId(userId).size();
+                if (count < seen) {
+                    readerFailed = true;
+                }
+                seen = count;
+                dm.getOrders();
+                dm.getMeals();
+                dm.getOrderSummaries();
+                reports.setStrategy(new RevenueReportStrategy());
+                reports.setArchive(dm.getArchive());
+                reports.generateReport(dm.getOrderColumns(), dm.getMeals(), dm.getUsers());
+            }
+        }));
+    }
+
+    threads.emplace_back(QThread::create([&dm, &writersLeft, mealId]() {
+        while (writersLeft.load() > 0) {
+            dm.saveData();
+            dm.updateMeal(Meal(mealId, "Каша", Money::fromKopecks(PriceKopecks), 1));
+            dm.getMemoryReport();
+            QThread::msleep(5);
+        }
+    }));
+
+    for (auto &thread : threads) {
+        thread->start();
+    }
+    for (auto &thread : threads) {
+        thread->wait();
+    }
+
+    auto verify = [&](const char *stage) {
+        std::printf("%s: %lld orders\n", stage, static_cast<long long>(dm.getOrders().size()));
+        check(dm.getOrders().size() == WriterThreads * OrdersPerWriter, "every placed order is stored");
+        for (int userId : students) {
+            check(dm.getOrdersByUserId(userId).size() == OrdersPerWriter, "orders per student");
+            const std::optional<User> user = dm.getUserById(userId);
+            check(user && user->getBalance() == Money(), "balance is charged exactly once per order");
+        }
+    };
+
+    check(placed.load() == WriterThreads * OrdersPerWriter, "all orders are accepted");
+    check(!readerFailed.load(), "readers never see orders disappear");
+    verify("after concurrent run");
+
+    dm.saveData();
+    dm.loadData();
+    verify("after save and reload");
+    
+    // Поврежденный месяц без индекса: индекс перестраивается без него и не перезаписывается,
+    // поэтому сохранение пишет файл текущего месяца, но оставляет прежние снимок и журнал
+    const QDir ordersDir(QDir(dataDir.path()).filePath("orders"));
+    QFile::remove(ordersDir.filePath("index.json"));
+    QFile::remove(ordersDir.filePath("index.json.1"));
+    QFile damaged(ordersDir.filePath("2001-01.json"));
+    check(damaged.open(QIODevice::WriteOnly) && damaged.write("{ damaged") > 0, "damaged month is written");
+    damaged.close();
+    dm.loadData();
+    
+    std::optional<User> student = dm.getUserById(students.first());
+    check(student.has_value(), "student exists");
+    if (student) {
+        student->setBalance(Money::fromKopecks(PriceKopecks));
+        dm.updateUser(*student);
+    }
+    check(dm.placeOrder(students.first(), { qMakePair(mealId, 1) }), "order after the index failure");
+    dm.saveData();
+    for (int restart = 1; restart <= 2; ++restart) {
+        dm.loadData();
+        std::printf("restart %d with a stale index: %lld orders\n", restart,
+                    static_cast<long long>(dm.getOrders().size()));
+        check(dm.getOrders().size() == WriterThreads * OrdersPerWriter + 1, "journal orders are not duplicated");
+        const std::optional<User> reloaded = dm.getUserById(students.first());
+        check(reloaded && reloaded->getBalance() == Money(), "journal balance is applied once");
+    }
+
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
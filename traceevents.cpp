@@ -0,0 +1,178 @@
+#include "traceevents.h"
+#include <QMutex>
+#include <QSaveFile>
+#include <QCoreApplication>
+#include <QDebug>
+#include <memory>
+
+namespace TraceEvents {
+
+namespace detail {
+std::atomic<bool> active{false};
+}
+
+namespace {
+
+constexpr int DefaultCapacity = 65536;
+
+// Слот кольцевого буфера. sequence = номер события + 1 после записи, 0 - слот пишется;
+// читатель проверяет номер до и после копирования полей (как seqlock)
+struct Slot
+{
+    std::atomic<quint64> sequence{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> beginUs{0};
+    std::atomic<qint64> durationUs{0};
+    std::atomic<int> threadId{0};
+};
+
+struct Buffer
+{
+    std::unique_ptr<Slot[]> slots;
+    quint64 capacity = 0;
+    std::atomic<quint64> next{0};
+};
+
+QMutex controlMutex;                 // start/stop/writeTo
+std::atomic<Buffer *> currentBuffer{nullptr};
+QString outputPath;
+const auto epoch = std::chrono::steady_clock::now();
+std::atomic<int> nextThreadId{1};
+
+int currentThreadId()
+{
+    thread_local const int id = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+qint64 toMicroseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+QByteArray escapeJson(const char *text)
+{
+    QByteArray escaped;
+    for (const char *c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+        }
+        escaped += *c;
+    }
+    return escaped;
+}
+
+}
+
+void start(const QString &path, int capacity)
+{
+    QMutexLocker locker(&controlMutex);
+    if (currentBuffer.load()) {
+        return;
+    }
+    // Буфер не освобождается до конца процесса: писатели могут держать указатель на него
+    Buffer *buffer = new Buffer;
+    buffer->capacity = quint64(capacity > 0 ? capacity : DefaultCapacity);
+    buffer->slots.reset(new Slot[buffer->capacity]);
+    outputPath = path;
+    currentBuffer.store(buffer, std::memory_order_release);
+    detail::active.store(true, std::memory_order_release);
+    qInfo() << "Trace: recording up to" << buffer->capacity << "events to" << path;
+}
+
+bool startFromEnvironment()
+{
+    const QString path = qEnvironmentVariable("CANTEEN_TRACE");
+    if (path.isEmpty()) {
+        return isActive();
+    }
+    start(path, qEnvironmentVariableIntValue("CANTEEN_TRACE_EVENTS"));
+    return true;
+}
+
+bool stop(QString *errorMessage)
+{
+    if (!isActive()) {
+        return true;
+    }
+    detail::active.store(false, std::memory_order_release);
+    QString path;
+    {
+        QMutexLocker locker(&controlMutex);
+        path = outputPath;
+    }
+    return writeTo(path, errorMessage);
+}
+
+bool writeTo(const QString &path, QString *errorMessage)
+{
+    QMutexLocker locker(&controlMutex);
+    Buffer *buffer = currentBuffer.load(std::memory_order_acquire);
+    if (!buffer) {
+        if (errorMessage) {
+            *errorMessage = "Трассировка не включена";
+        }
+        return false;
+    }
+
+    const quint64 end = buffer->next.load(std::memory_order_acquire);
+    const quint64 begin = end > buffer->capacity ? end - buffer->capacity : 0;
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QByteArray json;
+    json.reserve(int((end - begin) * 96 + 256));
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(pid)
+            + ",\"tid\":0,\"args\":{\"name\":\"canteen\"}}";
+    int dropped = 0;
+    for (quint64 index = begin; index < end; ++index) {
+        const Slot &slot = buffer->slots[index % buffer->capacity];
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        const char *name = slot.name.load(std::memory_order_relaxed);
+        const qint64 beginUs = slot.beginUs.load(std::memory_order_relaxed);
+        const qint64 durationUs = slot.durationUs.load(std::memory_order_relaxed);
+        const int threadId = slot.threadId.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Слот перезаписан или еще пишется
+        if (sequence != index + 1 || slot.sequence.load(std::memory_order_relaxed) != sequence || !name) {
+            ++dropped;
+            continue;
+        }
+        json += ",\n{\"name\":\"" + escapeJson(name) + "\",\"ph\":\"X\",\"pid\":" + QByteArray::number(pid)
+                + ",\"tid\":" + QByteArray::number(threadId)
+                + ",\"ts\":" + QByteArray::number(beginUs)
+                + ",\"dur\":" + QByteArray::number(durationUs) + "}";
+    }
+    json += "\n]}\n";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    qInfo() << "Trace: wrote" << (end - begin - dropped) << "events to" << path
+            << "(" << begin << "older events overwritten )";
+    return true;
+}
+
+void complete(const char *name, std::chrono::steady_clock::time_point begin,
+              std::chrono::steady_clock::duration duration)
+{
+    Buffer *buffer = currentBuffer.load(std::memory_order_acquire);
+    if (!buffer || !name) {
+        return;
+    }
+    const quint64 index = buffer->next.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = buffer->slots[index % buffer->capacity];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.beginUs.store(toMicroseconds(begin - epoch), std::memory_order_relaxed);
+    slot.durationUs.store(toMicroseconds(duration), std::memory_order_relaxed);
+    slot.threadId.store(currentThreadId(), std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef TRACEEVENTS_H
+#define TRACEEVENTS_H
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+
+// Трассировка в формате Chrome Trace Event (открывается в Perfetto и chrome://tracing).
+// Каждая точка PERF_SCOPE (сборка с CANTEEN_PERF_STATS) при включенной трассировке пишет событие "X"
+// (начало и длительность) в кольцевой буфер фиксированного размера: старые события
+// перезаписываются, память не растет.
+// Включается переменной окружения CANTEEN_TRACE=<файл> или ключом --trace <файл>;
+// размер буфера - CANTEEN_TRACE_EVENTS (по умолчанию 65536 событий).
+namespace TraceEvents {
+
+namespace detail {
+extern std::atomic<bool> active;
+}
+
+inline bool isActive() { return detail::active.load(std::memory_order_relaxed); }
+
+// Включает запись; файл пишется в stop() (или writeTo)
+void start(const QString &outputPath, int capacity = 0);
+// Включает запись, если задана CANTEEN_TRACE; возвращает, включена ли трассировка
+bool startFromEnvironment();
+// Выключает запись и сохраняет буфер в файл из start()
+bool stop(QString *errorMessage = nullptr);
+bool writeTo(const QString &path, QString *errorMessage = nullptr);
+
+void complete(const char *name, std::chrono::steady_clock::time_point begin,
+              std::chrono::steady_clock::duration duration);
+
+}
+
+#endif // TRACEEVENTS_H
@@ -2,19 +2,13 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QCryptographicHash>
-#include <QRegularExpression>
 
-User::User(int id, const QString &username, const QString &password, UserType type, double balance)
-    : m_id(id), m_username(username), m_type(type), m_balance(balance)
+User::User(int id, QString username, QString password, UserType type, Money balance)
+    : m_id(id), m_username(std::move(username)), m_password(std::move(password)), m_type(type), m_balance(balance)
 {
-    if (isHashed(password)) {
-        m_password = password;
-    } else {
-        m_password = hashPassword(password);
-    }
 }
 
-bool User::deductBalance(double amount)
+bool User::deductBalance(Money amount)
 {
     if (m_balance >= amount) {
         m_balance -= amount;
@@ -35,14 +29,23 @@ bool User::isHashed(const QString &password)
     if (password.length() != 64) {
         return false;
     }
-    QRegularExpression hexRegex("^[0-9a-fA-F]{64}$");
-    return hexRegex.match(password).hasMatch();
+    for (const QChar c : password) {
+        const char16_t u = c.unicode();
+        if (!((u >= '0' && u <= '9') || (u >= 'a' && u <= 'f') || (u >= 'A' && u <= 'F'))) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool User::verifyPassword(const QString &password) const
 {
-    QString hashedPassword = hashPassword(password);
-    return m_password == hashedPassword;
+    // Открытый пароль из старого файла данных, еще не обработанный миграцией
+    if (!isHashed(m_password)) {
+        return m_password == password;
+    }
+    // Хэш мог быть записан заглавными буквами (другой программой или вручную)
+    return m_password.compare(hashPassword(password), Qt::CaseInsensitive) == 0;
 }
 
 QString User::toJson() const
@@ -52,7 +55,7 @@ QString User::toJson() const
     obj["username"] = m_username;
     obj["password"] = m_password;
     obj["type"] = static_cast<int>(m_type);
-    obj["balance"] = m_balance;
+    obj["balanceKopecks"] = m_balance.kopecks();
     
     QJsonDocument doc(obj);
     return doc.toJson(QJsonDocument::Compact);
@@ -68,7 +71,7 @@ User User::fromJson(const QString &json)
         obj["username"].toString(),
         obj["password"].toString(),
         static_cast<UserType>(obj["type"].toInt()),
-        obj["balance"].toDouble()
+        Money::fromJson(obj, "balanceKopecks", "balance")
     );
 }
 
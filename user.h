@@ -3,27 +3,34 @@
 
 #include <QObject>
 #include <QString>
+#include <utility>
+#include "money.h"
 
 enum class UserType { Admin, Student };
 
 class User {
 public:
-  User(int id, const QString &username, const QString &password, UserType type,
-       double balance = 0.0);
+  // password - хэш из hashPassword; открытый текст допускается только для
+  // старых записей до миграции (DataManager::startPasswordMigration)
+  User(int id, QString username, QString password, UserType type,
+       Money balance = Money());
 
   int getId() const { return m_id; }
-  QString getUsername() const { return m_username; }
-  QString getPassword() const { return m_password; }
+  const QString &getUsername() const { return m_username; }
+  const QString &getPassword() const { return m_password; }
   UserType getType() const { return m_type; }
-  double getBalance() const { return m_balance; }
+  Money getBalance() const { return m_balance; }
 
-  void setBalance(double balance) { m_balance = balance; }
-  void addBalance(double amount) { m_balance += amount; }
-  bool deductBalance(double amount);
+  void setBalance(Money balance) { m_balance = balance; }
+  void addBalance(Money amount) { m_balance += amount; }
+  void setPasswordHash(QString hash) { m_password = std::move(hash); }
+  bool deductBalance(Money amount);
 
   bool verifyPassword(const QString &password) const;
   
   static QString hashPassword(const QString &password);
+  // Хэш - 64 шестнадцатеричные цифры в любом регистре; hashPassword выдает строчные.
+  // Такая запись никогда не считается открытым паролем
   static bool isHashed(const QString &password);
 
   QString toJson() const;
@@ -34,7 +41,7 @@ private:
   QString m_username;
   QString m_password;
   UserType m_type;
-  double m_balance;
+  Money m_balance;
 };
 
 #endif // USER_H